@@ -8,6 +8,7 @@
 #include <keyboard.hpp>
 #include <gamepad.hpp>
 #include <midiloopback.hpp>
+#include <midifile.hpp>
 #include <settings.hpp>
 #include <engine/Engine.hpp>
 #include <app/common.hpp>
@@ -23,6 +24,7 @@
 #include <string.hpp>
 #include <library.hpp>
 #include <network.hpp>
+#include <dsp/kernels.hpp>
 
 #include <getopt.h>
 #include <unistd.h> // for getopt
@@ -83,6 +85,7 @@ int main(int argc, char* argv[]) {
 		{"user", required_argument, NULL, 'u'},
 		{"version", no_argument, NULL, 'v'},
 		{"help", no_argument, NULL, 256},
+		{"seed", required_argument, NULL, 257},
 		{NULL, 0, NULL, 0}
 	};
 	int c;
@@ -118,6 +121,10 @@ int main(int argc, char* argv[]) {
 				std::fprintf(stderr, "https://vcvrack.com/manual/Installing#Command-line-usage\n");
 				return 0;
 			}
+			case 257: { // --seed
+				// Make random generators deterministic, for reproducible headless renders
+				random::seed(std::strtoull(optarg, NULL, 0));
+			} break;
 			// Mac "app translocation" passes a nonsense -psn_... flag, so -p is reserved.
 			case 'p': break;
 			default: break;
@@ -151,6 +158,7 @@ int main(int argc, char* argv[]) {
 	// Log environment
 	INFO("%s", appInfo.c_str());
 	INFO("%s", system::getOperatingSystemInfo().c_str());
+	INFO("DSP kernels: %s", dsp::getCpuLevelName(dsp::getCpuLevel()).c_str());
 	std::string argsList;
 	for (int i = 0; i < argc; i++) {
 		argsList += argv[i];
@@ -198,6 +206,7 @@ int main(int argc, char* argv[]) {
 	keyboard::init();
 	gamepad::init();
 	midiloopback::init();
+	midifile::init();
 	INFO("Initializing plugins");
 	plugin::init();
 	INFO("Initializing browser");
@@ -0,0 +1,338 @@
+/*
+Accuracy test and micro-benchmark of the approximations in <dsp/approx.hpp>.
+
+Measures the maximum error of each function and accuracy tier over its domain with `float` and every float vector type of the compilation target, and fails if it exceeds the bound documented in the header.
+Then measures the time per element of each type over a 1024-element buffer, in TSC cycles on x64 and nanoseconds elsewhere, and of the standard library function for comparison.
+
+	make bench
+
+To test the float_8 and float_16 specializations, build with AVX or AVX-512 enabled, e.g.
+
+	make bench EXTRA_FLAGS=-mavx2
+	make bench EXTRA_FLAGS=-mavx512f
+*/
+#include <dsp/approx.hpp>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#if defined ARCH_X64
+	#include <x86intrin.h>
+#endif
+
+
+using namespace rack;
+using simd::float_4;
+#if defined(__AVX__)
+using simd::float_8;
+#endif
+#if defined(__AVX512F__)
+using simd::float_16;
+#endif
+
+
+static const int ACCURACY_SAMPLES = 1 << 23;
+static const int TIMING_SIZE = 1024;
+static const int TIMING_REPEATS = 20000;
+
+
+static double getTicks() {
+#if defined ARCH_X64
+	return __rdtsc();
+#else
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#if defined ARCH_X64
+static const char* TICK_UNIT = "cycles";
+#else
+static const char* TICK_UNIT = "ns";
+#endif
+
+
+/** Quasi-random sequence in [0, 1) */
+static double golden(int i) {
+	double x = i * 0.6180339887498949;
+	return x - std::floor(x);
+}
+
+
+// Functions under test.
+// Each has the approximation, a double-precision reference, the standard library function for comparison, and the domain to sample.
+
+struct Exp2 {
+	static const char* name() {return "exp2Approx";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::exp2Approx<A>(x);}
+	static double ref(double x, double) {return std::exp2(x);}
+	static float std(float x, float) {return std::exp2(x);}
+	static bool relative() {return true;}
+	static float x(int i, int n) {return -126.f + 254.f * i / n;}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {1.1e-4f, 3.5e-6f, 9.4e-8f};
+		return bounds[a];
+	}
+};
+
+struct Log2 {
+	static const char* name() {return "log2Approx";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::log2Approx<A>(x);}
+	static double ref(double x, double) {return std::log2(x);}
+	static float std(float x, float) {return std::log2(x);}
+	static bool relative() {return false;}
+	// x in [1/16, 16)
+	static float x(int i, int n) {return std::exp2(-4.f + 8.f * i / n);}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {8.8e-4f, 2.5e-6f, 2.4e-7f};
+		return bounds[a];
+	}
+};
+
+struct Pow {
+	static const char* name() {return "powApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T a, T b) {return dsp::powApprox<A>(a, b);}
+	static double ref(double a, double b) {return std::pow(a, b);}
+	static float std(float a, float b) {return std::pow(a, b);}
+	static bool relative() {return true;}
+	// a in [1/16, 16), b in [-4, 4)
+	static float x(int i, int n) {return std::exp2(-4.f + 8.f * i / n);}
+	static float y(int i) {return -4.f + 8.f * golden(i);}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {2.6e-3f, 1.1e-5f, 9.1e-7f};
+		return bounds[a];
+	}
+};
+
+struct Cos2pi {
+	static const char* name() {return "cos2piApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::cos2piApprox<A>(x);}
+	static double ref(double x, double) {return std::cos(2 * M_PI * x);}
+	static float std(float x, float) {return std::cos(float(2 * M_PI) * x);}
+	static bool relative() {return false;}
+	static float x(int i, int n) {return -1.f + 2.f * i / n;}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {6.8e-5f, 7.4e-7f, 2.1e-7f};
+		return bounds[a];
+	}
+};
+
+struct Sin2pi {
+	static const char* name() {return "sin2piApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::sin2piApprox<A>(x);}
+	static double ref(double x, double) {return std::sin(2 * M_PI * x);}
+	static float std(float x, float) {return std::sin(float(2 * M_PI) * x);}
+	static bool relative() {return false;}
+	static float x(int i, int n) {return -1.f + 2.f * i / n;}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		return Cos2pi::bound(a);
+	}
+};
+
+struct Cos {
+	static const char* name() {return "cosApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::cosApprox<A>(x);}
+	static double ref(double x, double) {return std::cos(x);}
+	static float std(float x, float) {return std::cos(x);}
+	static bool relative() {return false;}
+	// x in [-2 pi, 2 pi)
+	static float x(int i, int n) {return float(2 * M_PI) * (-1.f + 2.f * i / n);}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {6.9e-5f, 1.0e-6f, 4.5e-7f};
+		return bounds[a];
+	}
+};
+
+struct Sin {
+	static const char* name() {return "sinApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::sinApprox<A>(x);}
+	static double ref(double x, double) {return std::sin(x);}
+	static float std(float x, float) {return std::sin(x);}
+	static bool relative() {return false;}
+	static float x(int i, int n) {return float(2 * M_PI) * (-1.f + 2.f * i / n);}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		return Cos::bound(a);
+	}
+};
+
+struct Tanh {
+	static const char* name() {return "tanhApprox";}
+	template <dsp::Accuracy A, typename T>
+	static T approx(T x, T) {return dsp::tanhApprox<A>(x);}
+	static double ref(double x, double) {return std::tanh(x);}
+	static float std(float x, float) {return std::tanh(x);}
+	static bool relative() {return false;}
+	static float x(int i, int n) {return -10.f + 20.f * i / n;}
+	static float y(int i) {return 0.f;}
+	static float bound(dsp::Accuracy a) {
+		const float bounds[] = {5.2e-5f, 1.8e-6f, 1.4e-7f};
+		return bounds[a];
+	}
+};
+
+
+template <typename F>
+static double getError(double y, double x, double b) {
+	double r = F::ref(x, b);
+	double e = std::fabs(y - r);
+	if (F::relative())
+		e /= std::fabs(r);
+	return e;
+}
+
+
+/** Returns the maximum error of the float version */
+template <typename F, dsp::Accuracy A>
+static double measureScalarError() {
+	double maxError = 0.0;
+	for (int i = 0; i < ACCURACY_SAMPLES; i++) {
+		float x = F::x(i, ACCURACY_SAMPLES);
+		float b = F::y(i);
+		float y = F::template approx<A>(x, b);
+		maxError = std::fmax(maxError, getError<F>(y, x, b));
+	}
+	return maxError;
+}
+
+/** Returns the maximum error of the vector version of type `V` */
+template <typename F, dsp::Accuracy A, typename V>
+static double measureError() {
+	double maxError = 0.0;
+	for (int i = 0; i < ACCURACY_SAMPLES; i += V::size) {
+		float x[V::size], b[V::size], y[V::size];
+		for (int j = 0; j < V::size; j++) {
+			x[j] = F::x(i + j, ACCURACY_SAMPLES);
+			b[j] = F::y(i + j);
+		}
+		F::template approx<A>(V::load(x), V::load(b)).store(y);
+		for (int j = 0; j < V::size; j++) {
+			maxError = std::fmax(maxError, getError<F>(y[j], x[j], b[j]));
+		}
+	}
+	return maxError;
+}
+
+
+struct Buffers {
+	std::vector<float> x, b, y;
+
+	template <typename F>
+	void init() {
+		x.resize(TIMING_SIZE);
+		b.resize(TIMING_SIZE);
+		y.resize(TIMING_SIZE);
+		for (int i = 0; i < TIMING_SIZE; i++) {
+			x[i] = F::x(i, TIMING_SIZE);
+			b[i] = F::y(i);
+		}
+	}
+};
+
+
+/** Returns the time per element of the vector version of type `V` */
+template <typename F, dsp::Accuracy A, typename V>
+static double measureTime(Buffers& buf) {
+	double start = getTicks();
+	for (int r = 0; r < TIMING_REPEATS; r++) {
+		for (int i = 0; i < TIMING_SIZE; i += V::size) {
+			F::template approx<A>(V::load(&buf.x[i]), V::load(&buf.b[i])).store(&buf.y[i]);
+		}
+	}
+	return (getTicks() - start) / TIMING_REPEATS / TIMING_SIZE;
+}
+
+/** Returns the time per element of the float version */
+template <typename F, dsp::Accuracy A>
+static double measureScalarTime(Buffers& buf) {
+	double start = getTicks();
+	for (int r = 0; r < TIMING_REPEATS; r++) {
+		for (int i = 0; i < TIMING_SIZE; i++) {
+			buf.y[i] = F::template approx<A>(buf.x[i], buf.b[i]);
+		}
+	}
+	return (getTicks() - start) / TIMING_REPEATS / TIMING_SIZE;
+}
+
+template <typename F>
+static double measureStdTime(Buffers& buf) {
+	double start = getTicks();
+	for (int r = 0; r < TIMING_REPEATS; r++) {
+		for (int i = 0; i < TIMING_SIZE; i++) {
+			buf.y[i] = F::std(buf.x[i], buf.b[i]);
+		}
+	}
+	return (getTicks() - start) / TIMING_REPEATS / TIMING_SIZE;
+}
+
+
+template <typename F, dsp::Accuracy A>
+static bool benchTier(const char* tierName, Buffers& buf) {
+	double error = measureScalarError<F, A>();
+	error = std::fmax(error, measureError<F, A, float_4>());
+#if defined(__AVX__)
+	error = std::fmax(error, measureError<F, A, float_8>());
+#endif
+#if defined(__AVX512F__)
+	error = std::fmax(error, measureError<F, A, float_16>());
+#endif
+	bool ok = (error <= F::bound(A));
+	std::printf("%-14s %-8s %10.2e %10.2e", F::name(), tierName, error, F::bound(A));
+	std::printf(" %8.2f", measureScalarTime<F, A>(buf));
+	std::printf(" %8.2f", measureTime<F, A, float_4>(buf));
+#if defined(__AVX__)
+	std::printf(" %8.2f", measureTime<F, A, float_8>(buf));
+#endif
+#if defined(__AVX512F__)
+	std::printf(" %8.2f", measureTime<F, A, float_16>(buf));
+#endif
+	std::printf(" %s\n", ok ? "" : "FAIL");
+	return ok;
+}
+
+
+template <typename F>
+static bool bench() {
+	Buffers buf;
+	buf.init<F>();
+	bool ok = true;
+	ok &= benchTier<F, dsp::ACCURACY_LOW>("LOW", buf);
+	ok &= benchTier<F, dsp::ACCURACY_MEDIUM>("MEDIUM", buf);
+	ok &= benchTier<F, dsp::ACCURACY_HIGH>("HIGH", buf);
+	std::printf("%-14s %-8s %10s %10s %8.2f\n", "", "std", "", "", measureStdTime<F>(buf));
+	return ok;
+}
+
+
+int main() {
+	std::printf("Time per element in %s\n", TICK_UNIT);
+	std::printf("%-14s %-8s %10s %10s %8s %8s", "function", "accuracy", "max error", "bound", "float", "float_4");
+#if defined(__AVX__)
+	std::printf(" %8s", "float_8");
+#endif
+#if defined(__AVX512F__)
+	std::printf(" %8s", "float_16");
+#endif
+	std::printf("\n");
+	bool ok = true;
+	ok &= bench<Exp2>();
+	ok &= bench<Log2>();
+	ok &= bench<Pow>();
+	ok &= bench<Cos2pi>();
+	ok &= bench<Sin2pi>();
+	ok &= bench<Cos>();
+	ok &= bench<Sin>();
+	ok &= bench<Tanh>();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+/*
+Producer/consumer benchmark of dsp::RingBuffer.
+
+A producer thread pushes a sequence of integers while a consumer thread shifts and checks them, so the indices are contended across cores.
+Fails if any element is lost, duplicated, or reordered.
+Compares push()/shift(), the endData()/startData() span API, both APIs mixed on each side, and the previous sequentially-consistent, unpadded RingBuffer.
+Before that, checks on one thread that the span API reports correct sizes after push(), shift(), and clear().
+
+	make bench
+*/
+#include <dsp/ringbuffer.hpp>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+
+using namespace rack;
+
+
+static const uint32_t COUNT = 1 << 25;
+static const size_t SIZE = 1 << 12;
+static const int RUNS = 3;
+
+
+/** RingBuffer before acquire/release ordering, padding, and index caching, for comparison */
+template <typename T, size_t S>
+struct SeqCstRingBuffer {
+	std::atomic<size_t> start{0};
+	std::atomic<size_t> end{0};
+	T data[S];
+
+	void push(T t) {
+		size_t i = end % S;
+		data[i] = t;
+		end++;
+	}
+	T shift() {
+		size_t i = start % S;
+		T t = data[i];
+		start++;
+		return t;
+	}
+	bool empty() const {
+		return start >= end;
+	}
+	bool full() const {
+		return end - start >= S;
+	}
+};
+
+
+/** Pushes and shifts one element at a time, checking full() and empty() */
+template <typename R>
+struct SingleBench {
+	static void produce(R* r) {
+		for (uint32_t i = 0; i < COUNT;) {
+			if (r->full()) {
+				std::this_thread::yield();
+				continue;
+			}
+			r->push(i++);
+		}
+	}
+	static bool consume(R* r) {
+		bool ok = true;
+		for (uint32_t i = 0; i < COUNT;) {
+			if (r->empty()) {
+				std::this_thread::yield();
+				continue;
+			}
+			ok &= (r->shift() == i++);
+		}
+		return ok;
+	}
+};
+
+
+/** Writes and reads contiguous spans, committing each one with a single index store */
+template <typename R>
+struct SpanBench {
+	static void produce(R* r) {
+		for (uint32_t i = 0; i < COUNT;) {
+			size_t n;
+			uint32_t* data = r->endData(&n);
+			if (n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			n = std::min<size_t>(n, COUNT - i);
+			for (size_t j = 0; j < n; j++) {
+				data[j] = i++;
+			}
+			r->endIncr(n);
+		}
+	}
+	static bool consume(R* r) {
+		bool ok = true;
+		for (uint32_t i = 0; i < COUNT;) {
+			size_t n;
+			const uint32_t* data = r->startData(&n);
+			if (n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			for (size_t j = 0; j < n; j++) {
+				ok &= (data[j] == i++);
+			}
+			r->startIncr(n);
+		}
+		return ok;
+	}
+};
+
+
+/** Alternates between push()/shift() and the span API on each side */
+template <typename R>
+struct MixedBench {
+	static void produce(R* r) {
+		for (uint32_t i = 0; i < COUNT;) {
+			if (i % 3 == 0) {
+				if (r->full()) {
+					std::this_thread::yield();
+					continue;
+				}
+				r->push(i++);
+				continue;
+			}
+			size_t n;
+			uint32_t* data = r->endData(&n);
+			if (n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			n = std::min<size_t>(n, std::min<uint32_t>(7, COUNT - i));
+			for (size_t j = 0; j < n; j++) {
+				data[j] = i++;
+			}
+			r->endIncr(n);
+		}
+	}
+	static bool consume(R* r) {
+		bool ok = true;
+		for (uint32_t i = 0; i < COUNT;) {
+			if (i % 5 == 0) {
+				if (r->empty()) {
+					std::this_thread::yield();
+					continue;
+				}
+				ok &= (r->shift() == i++);
+				continue;
+			}
+			size_t n;
+			const uint32_t* data = r->startData(&n);
+			if (n == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			n = std::min<size_t>(n, 11);
+			for (size_t j = 0; j < n; j++) {
+				ok &= (data[j] == i++);
+			}
+			r->startIncr(n);
+		}
+		return ok;
+	}
+};
+
+
+/** Checks that endData() and startData() never report more than capacity() and size() after the other APIs moved the indices */
+static bool checkSpans() {
+	bool ok = true;
+	dsp::RingBuffer<uint32_t, 8> r;
+	size_t n;
+	// Fill the span caches, then move the indices with push() and shift() only
+	r.endData(&n);
+	r.startData(&n);
+	for (uint32_t i = 0; i < 20; i++) {
+		r.push(i);
+		if (i >= 6)
+			r.shift();
+	}
+	uint32_t* end = r.endData(&n);
+	ok &= (n <= r.capacity());
+	// Write the whole reported span, which must not overwrite unread elements
+	for (size_t j = 0; j < n; j++) {
+		end[j] = 100 + j;
+	}
+	r.endIncr(n);
+	for (uint32_t i = 14; i < 20; i++) {
+		ok &= (r.shift() == i);
+	}
+	// After clear(), nothing is readable
+	r.clear();
+	r.startData(&n);
+	ok &= (n == 0);
+	r.push(1);
+	r.startData(&n);
+	ok &= (n == 1);
+	return ok;
+}
+
+
+/** Returns the best throughput of several runs in millions of elements per second, or 0 if an element was wrong */
+template <typename R, typename B>
+static double measure() {
+	double best = 0.0;
+	for (int run = 0; run < RUNS; run++) {
+		R* r = new R;
+		auto startTime = std::chrono::steady_clock::now();
+		std::thread producer(B::produce, r);
+		bool ok = B::consume(r);
+		producer.join();
+		double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		delete r;
+		if (!ok)
+			return 0.0;
+		best = std::max(best, COUNT / duration / 1e6);
+	}
+	return best;
+}
+
+
+int main() {
+	if (!checkSpans()) {
+		std::printf("FAIL: span sizes are wrong after push(), shift(), or clear()\n");
+		return 1;
+	}
+
+	std::printf("Producer/consumer throughput of %u uint32 elements, %u hardware threads\n", COUNT, std::thread::hardware_concurrency());
+	std::printf("%-32s %10s\n", "method", "M/s");
+
+	double seqCst = measure<SeqCstRingBuffer<uint32_t, SIZE>, SingleBench<SeqCstRingBuffer<uint32_t, SIZE>>>();
+	std::printf("%-32s %10.1f\n", "seq_cst push/shift", seqCst);
+	double single = measure<dsp::RingBuffer<uint32_t, SIZE>, SingleBench<dsp::RingBuffer<uint32_t, SIZE>>>();
+	std::printf("%-32s %10.1f\n", "RingBuffer push/shift", single);
+	double span = measure<dsp::RingBuffer<uint32_t, SIZE>, SpanBench<dsp::RingBuffer<uint32_t, SIZE>>>();
+	std::printf("%-32s %10.1f\n", "RingBuffer endData/startData", span);
+	double mixed = measure<dsp::RingBuffer<uint32_t, SIZE>, MixedBench<dsp::RingBuffer<uint32_t, SIZE>>>();
+	std::printf("%-32s %10.1f\n", "RingBuffer mixed", mixed);
+
+	if (seqCst == 0.0 || single == 0.0 || span == 0.0 || mixed == 0.0) {
+		std::printf("FAIL: elements were lost or reordered\n");
+		return 1;
+	}
+	return 0;
+}
@@ -102,6 +102,28 @@ inline simd::float_4 exp2Floor(simd::float_4 x, simd::float_4* xf) {
 	return simd::float_4::cast(yii);
 }
 
+#if defined(__AVX__)
+template <>
+inline simd::float_8 exp2Floor(simd::float_8 x, simd::float_8* xf) {
+	simd::float_4 xfLo, xfHi;
+	simd::float_8 y(exp2Floor(x.lo(), &xfLo), exp2Floor(x.hi(), &xfHi));
+	if (xf)
+		*xf = simd::float_8(xfLo, xfHi);
+	return y;
+}
+#endif
+
+#if defined(__AVX512F__)
+template <>
+inline simd::float_16 exp2Floor(simd::float_16 x, simd::float_16* xf) {
+	x += 127;
+	__m512i xi = _mm512_cvttps_epi32(x.v);
+	if (xf)
+		*xf = x - simd::float_16(_mm512_cvtepi32_ps(xi));
+	return simd::float_16(_mm512_castsi512_ps(_mm512_slli_epi32(xi, 23)));
+}
+#endif
+
 /** Deprecated alias of exp2Floor() */
 template <typename T>
 T approxExp2Floor(T x, T* xf) {
@@ -138,5 +160,239 @@ T approxExp2_taylor5(T x) {
 }
 
 
+/** Returns `floor(log2(x))` for positive normal `x`.
+If xf is given, sets it to the fractional part of the mantissa, `x / 2^floor(log2(x)) - 1`, in [0, 1).
+This is useful in the computation `log2(x) = floor(log2(x)) + log2(1 + xf)`.
+*/
+template <typename T>
+T log2Floor(T x, T* xf);
+
+template <>
+inline float log2Floor(float x, float* xf) {
+	union {
+		float xi;
+		int32_t xii;
+	};
+	xi = x;
+	int32_t e = (xii >> 23) - 127;
+	if (xf) {
+		// Set exponent of float to 0
+		xii = (xii & 0x007fffff) | 0x3f800000;
+		*xf = xi - 1.f;
+	}
+	return e;
+}
+
+template <>
+inline simd::float_4 log2Floor(simd::float_4 x, simd::float_4* xf) {
+	simd::int32_4 xii = simd::int32_4::cast(x);
+	simd::float_4 e = simd::float_4((xii >> 23) - 127);
+	if (xf)
+		*xf = simd::float_4::cast((xii & 0x007fffff) | 0x3f800000) - 1.f;
+	return e;
+}
+
+#if defined(__AVX__)
+template <>
+inline simd::float_8 log2Floor(simd::float_8 x, simd::float_8* xf) {
+	simd::float_4 xfLo, xfHi;
+	simd::float_8 e(log2Floor(x.lo(), &xfLo), log2Floor(x.hi(), &xfHi));
+	if (xf)
+		*xf = simd::float_8(xfLo, xfHi);
+	return e;
+}
+#endif
+
+#if defined(__AVX512F__)
+template <>
+inline simd::float_16 log2Floor(simd::float_16 x, simd::float_16* xf) {
+	__m512i xii = _mm512_castps_si512(x.v);
+	__m512i e = _mm512_sub_epi32(_mm512_srli_epi32(xii, 23), _mm512_set1_epi32(127));
+	if (xf) {
+		__m512i m = _mm512_or_si512(_mm512_and_si512(xii, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000));
+		*xf = simd::float_16(_mm512_castsi512_ps(m)) - 1.f;
+	}
+	return simd::float_16(_mm512_cvtepi32_ps(e));
+}
+#endif
+
+
+/** Accuracy tiers of the approximations below.
+Each function is templated on `float` and the `simd::Vector` float types, and documents the maximum error of each tier, measured over its domain with single-precision arithmetic by `make bench` (bench/approx.cpp).
+The bounds hold whether or not the compiler fuses multiplies and adds, as it does for `float` and float_16 when FMA or AVX-512 is enabled.
+Lower tiers evaluate shorter polynomials, so they are faster.
+
+Example:
+
+	float_4 y = dsp::tanhApprox<dsp::ACCURACY_LOW>(gain * x);
+*/
+enum Accuracy {
+	/** Error on the order of 1e-3 */
+	ACCURACY_LOW,
+	/** Error on the order of 1e-5 */
+	ACCURACY_MEDIUM,
+	/** Error within a few ulp of single precision */
+	ACCURACY_HIGH,
+};
+
+
+/** Returns 2^x.
+Maximum relative error:
+- ACCURACY_LOW: 1.1e-4
+- ACCURACY_MEDIUM: 3.5e-6
+- ACCURACY_HIGH: 9.4e-8
+
+`x` must be in [-126, 128).
+Exact at integer values of `x` and continuous.
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T exp2Approx(T x) {
+	// exp2Floor() computes the fractional part after adding an offset, which rounds it to about 1e-5.
+	// Subtracting the floor is exact.
+	T xi = simd::floor(x);
+	T xf = x - xi;
+	T yi = exp2Floor(xi, (T*) NULL);
+	T yf;
+	// Minimax polynomials constrained by p(0) = 1 and p(1) = 2
+	if (A == ACCURACY_LOW) {
+		const T a[] = {1.f, 0.6954243475f, 0.2263076823f, 0.07826797016f};
+		yf = polyHorner(a, xf);
+	}
+	else if (A == ACCURACY_MEDIUM) {
+		const T a[] = {1.f, 0.6930321208f, 0.2413797629f, 0.05203236901f, 0.01355574723f};
+		yf = polyHorner(a, xf);
+	}
+	else {
+		const T a[] = {1.f, 0.6931470324f, 0.2402295133f, 0.05548415248f, 0.009678063877f, 0.001244087705f, 0.0002171502549f};
+		yf = polyHorner(a, xf);
+	}
+	return yi * yf;
+}
+
+
+/** Returns log2(x).
+Maximum absolute error for `x` in [1/16, 16):
+- ACCURACY_LOW: 8.8e-4
+- ACCURACY_MEDIUM: 2.5e-6
+- ACCURACY_HIGH: 2.4e-7
+
+The polynomial error is the same for all `x`, but rounding of the result grows with `|log2(x)|`.
+
+`x` must be positive and normal.
+Exact at powers of 2 and continuous.
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T log2Approx(T x) {
+	T xf;
+	T yi = log2Floor(x, &xf);
+	T yf;
+	// Minimax polynomials constrained by p(0) = 0 and p(1) = 1
+	if (A == ACCURACY_LOW) {
+		const T a[] = {0.f, 1.422865375f, -0.5820855683f, 0.159220193f};
+		yf = polyHorner(a, xf);
+	}
+	else if (A == ACCURACY_MEDIUM) {
+		const T a[] = {0.f, 1.442544944f, -0.7181452567f, 0.4575491967f, -0.2779053442f, 0.1217979103f, -0.0258414497f};
+		yf = polyHorner(a, xf);
+	}
+	else {
+		const T a[] = {0.f, 1.442694031f, -0.7213041335f, 0.4802503111f, -0.3558450229f, 0.2675611249f, -0.1824461942f, 0.09753067398f, -0.03401574315f, 0.005574952356f};
+		yf = polyHorner(a, xf);
+	}
+	return yi + yf;
+}
+
+
+/** Returns `a^b` as `2^(b log2(a))`, for positive `a`.
+The relative error is about the relative error of exp2Approx() plus `|b| ln(2)` times the absolute error of log2Approx().
+Maximum relative error for `a` in [1/16, 16) and `b` in [-4, 4):
+- ACCURACY_LOW: 2.6e-3
+- ACCURACY_MEDIUM: 1.1e-5
+- ACCURACY_HIGH: 9.1e-7
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T powApprox(T a, T b) {
+	return exp2Approx<A>(b * log2Approx<A>(a));
+}
+
+
+/** Returns cos(2 pi x), where `x` is a phase in cycles.
+Maximum absolute error:
+- ACCURACY_LOW: 6.8e-5
+- ACCURACY_MEDIUM: 7.4e-7
+- ACCURACY_HIGH: 2.1e-7
+
+Error grows with the rounding error of `x` for large `|x|`, so wrap oscillator phases to a small range.
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T cos2piApprox(T x) {
+	// Reduce to [-0.5, 0.5)
+	x -= simd::floor(x + 0.5f);
+	// cos(2 pi x) = sin(2 pi (0.25 - |x|)), where 0.25 - |x| is in [-0.25, 0.25]
+	T s = 0.25f - simd::fabs(x);
+	T s2 = s * s;
+	T y;
+	// Odd minimax polynomials of sin(2 pi s)
+	if (A == ACCURACY_LOW) {
+		const T a[] = {6.281280074f, -41.0952425f, 73.58551176f};
+		y = polyHorner(a, s2);
+	}
+	else if (A == ACCURACY_MEDIUM) {
+		const T a[] = {6.283164044f, -41.33714237f, 81.34076873f, -70.99343164f};
+		y = polyHorner(a, s2);
+	}
+	else {
+		const T a[] = {6.28318516f, -41.34165503f, 81.60100407f, -76.54978222f, 39.53670548f};
+		y = polyHorner(a, s2);
+	}
+	return s * y;
+}
+
+/** Returns sin(2 pi x), where `x` is a phase in cycles.
+Has the same error as cos2piApprox().
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T sin2piApprox(T x) {
+	return cos2piApprox<A>(x - 0.25f);
+}
+
+/** Returns cos(x).
+Has the error of cos2piApprox() plus the rounding error of `x / (2 pi)`.
+Maximum absolute error for `x` in [-2 pi, 2 pi):
+- ACCURACY_LOW: 6.9e-5
+- ACCURACY_MEDIUM: 1.0e-6
+- ACCURACY_HIGH: 4.5e-7
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T cosApprox(T x) {
+	return cos2piApprox<A>(x * float(0.5 / M_PI));
+}
+
+/** Returns sin(x).
+Has the same error as cosApprox().
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T sinApprox(T x) {
+	return sin2piApprox<A>(x * float(0.5 / M_PI));
+}
+
+
+/** Returns tanh(x), computed from exp2Approx().
+Maximum absolute error:
+- ACCURACY_LOW: 5.2e-5
+- ACCURACY_MEDIUM: 1.8e-6
+- ACCURACY_HIGH: 1.4e-7
+
+Saturates to +-1 for large `|x|`, and returns exactly 0 at 0.
+*/
+template <Accuracy A = ACCURACY_MEDIUM, typename T>
+T tanhApprox(T x) {
+	// Beyond this, tanh(x) rounds to +-1 and 2^(2x/ln(2)) would overflow exp2Approx()
+	x = simd::clamp(x, T(-9.f), T(9.f));
+	T e = exp2Approx<A>(x * float(2 / M_LN2));
+	return (e - 1.f) / (e + 1.f);
+}
+
+
 } // namespace dsp
 } // namespace rack
@@ -8,6 +8,23 @@ namespace rack {
 namespace dsp {
 
 
+/** Returns a PFFFT setup of a given length and type, shared by all callers in the process.
+Setups are read-only once created, so a shared setup can be used by any number of threads at once.
+Thread-safe. Release with releaseFftSetup() when no longer needed.
+*/
+PFFFT_Setup* acquireFftSetup(int length, pffft_transform_t type);
+/** Releases a setup returned by acquireFftSetup(), destroying it when no other callers hold it. */
+void releaseFftSetup(PFFFT_Setup* setup);
+
+/** Returns a 16-byte aligned buffer of `size` floats, reusing a previously released buffer of the same size if possible.
+Contents are undefined.
+Thread-safe, but not real-time safe since it may allocate.
+*/
+float* acquireFftBuffer(size_t size);
+/** Returns a buffer from acquireFftBuffer() to the pool. `size` must match. */
+void releaseFftBuffer(float* buffer, size_t size);
+
+
 /** Real-valued FFT context.
 Wrapper for [PFFFT](https://bitbucket.org/jpommier/pffft/)
 `length` must be a multiple of 32.
@@ -19,11 +36,11 @@ struct RealFFT {
 
 	RealFFT(size_t length) {
 		this->length = length;
-		setup = pffft_new_setup(length, PFFFT_REAL);
+		setup = acquireFftSetup(length, PFFFT_REAL);
 	}
 
 	~RealFFT() {
-		pffft_destroy_setup(setup);
+		releaseFftSetup(setup);
 	}
 
 	/** Performs the real FFT.
@@ -84,11 +101,11 @@ struct ComplexFFT {
 
 	ComplexFFT(size_t length) {
 		this->length = length;
-		setup = pffft_new_setup(length, PFFFT_COMPLEX);
+		setup = acquireFftSetup(length, PFFFT_COMPLEX);
 	}
 
 	~ComplexFFT() {
-		pffft_destroy_setup(setup);
+		releaseFftSetup(setup);
 	}
 
 	/** Performs the complex FFT.
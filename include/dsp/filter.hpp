@@ -436,5 +436,262 @@ struct TBiquadFilter : IIRFilter<3, 3, T> {
 typedef TBiquadFilter<> BiquadFilter;
 
 
+/** Computes the coefficients of TBiquadFilter::setParameters() for a vector of parameters at once.
+Branches on `V` are evaluated with simd::ifelse(), so each lane can have a different gain.
+*/
+template <typename T>
+void computeBiquadCoefficients(typename TBiquadFilter<>::Type type, T f, T Q, T V, T* b, T* a) {
+	typedef TBiquadFilter<> F;
+	T K = simd::tan(float(M_PI) * f);
+	T K2 = K * K;
+	switch (type) {
+		case F::LOWPASS_1POLE: {
+			a[0] = -simd::exp(float(-2 * M_PI) * f);
+			a[1] = 0.f;
+			b[0] = 1.f + a[0];
+			b[1] = 0.f;
+			b[2] = 0.f;
+		} break;
+
+		case F::HIGHPASS_1POLE: {
+			a[0] = simd::exp(float(-2 * M_PI) * (0.5f - f));
+			a[1] = 0.f;
+			b[0] = 1.f - a[0];
+			b[1] = 0.f;
+			b[2] = 0.f;
+		} break;
+
+		case F::LOWPASS: {
+			T norm = 1.f / (1.f + K / Q + K2);
+			b[0] = K2 * norm;
+			b[1] = 2.f * b[0];
+			b[2] = b[0];
+			a[0] = 2.f * (K2 - 1.f) * norm;
+			a[1] = (1.f - K / Q + K2) * norm;
+		} break;
+
+		case F::HIGHPASS: {
+			T norm = 1.f / (1.f + K / Q + K2);
+			b[0] = norm;
+			b[1] = -2.f * b[0];
+			b[2] = b[0];
+			a[0] = 2.f * (K2 - 1.f) * norm;
+			a[1] = (1.f - K / Q + K2) * norm;
+		} break;
+
+		case F::LOWSHELF: {
+			T sqrtV = simd::sqrt(V);
+			auto boost = (V >= 1.f);
+			// V >= 1
+			T normB = 1.f / (1.f + float(M_SQRT2) * K + K2);
+			// V < 1
+			T normC = 1.f / (1.f + float(M_SQRT2) / sqrtV * K + K2 / V);
+			b[0] = simd::ifelse(boost, (1.f + float(M_SQRT2) * sqrtV * K + V * K2) * normB, (1.f + float(M_SQRT2) * K + K2) * normC);
+			b[1] = simd::ifelse(boost, 2.f * (V * K2 - 1.f) * normB, 2.f * (K2 - 1.f) * normC);
+			b[2] = simd::ifelse(boost, (1.f - float(M_SQRT2) * sqrtV * K + V * K2) * normB, (1.f - float(M_SQRT2) * K + K2) * normC);
+			a[0] = simd::ifelse(boost, 2.f * (K2 - 1.f) * normB, 2.f * (K2 / V - 1.f) * normC);
+			a[1] = simd::ifelse(boost, (1.f - float(M_SQRT2) * K + K2) * normB, (1.f - float(M_SQRT2) / sqrtV * K + K2 / V) * normC);
+		} break;
+
+		case F::HIGHSHELF: {
+			T sqrtV = simd::sqrt(V);
+			auto boost = (V >= 1.f);
+			T normB = 1.f / (1.f + float(M_SQRT2) * K + K2);
+			T normC = 1.f / (1.f / V + float(M_SQRT2) / sqrtV * K + K2);
+			b[0] = simd::ifelse(boost, (V + float(M_SQRT2) * sqrtV * K + K2) * normB, (1.f + float(M_SQRT2) * K + K2) * normC);
+			b[1] = simd::ifelse(boost, 2.f * (K2 - V) * normB, 2.f * (K2 - 1.f) * normC);
+			b[2] = simd::ifelse(boost, (V - float(M_SQRT2) * sqrtV * K + K2) * normB, (1.f - float(M_SQRT2) * K + K2) * normC);
+			a[0] = simd::ifelse(boost, 2.f * (K2 - 1.f) * normB, 2.f * (K2 - 1.f / V) * normC);
+			a[1] = simd::ifelse(boost, (1.f - float(M_SQRT2) * K + K2) * normB, (1.f / V - float(M_SQRT2) / sqrtV * K + K2) * normC);
+		} break;
+
+		case F::BANDPASS: {
+			T norm = 1.f / (1.f + K / Q + K2);
+			b[0] = K / Q * norm;
+			b[1] = 0.f;
+			b[2] = -b[0];
+			a[0] = 2.f * (K2 - 1.f) * norm;
+			a[1] = (1.f - K / Q + K2) * norm;
+		} break;
+
+		case F::PEAK: {
+			auto boost = (V >= 1.f);
+			// Boost widens the numerator, cut widens the denominator
+			T qNum = simd::ifelse(boost, Q / V, Q);
+			T qDen = simd::ifelse(boost, Q, Q * V);
+			T norm = 1.f / (1.f + K / qDen + K2);
+			b[0] = (1.f + K / qNum + K2) * norm;
+			b[1] = 2.f * (K2 - 1.f) * norm;
+			b[2] = (1.f - K / qNum + K2) * norm;
+			a[0] = b[1];
+			a[1] = (1.f - K / qDen + K2) * norm;
+		} break;
+
+		case F::NOTCH: {
+			T norm = 1.f / (1.f + K / Q + K2);
+			b[0] = (1.f + K2) * norm;
+			b[1] = 2.f * (K2 - 1.f) * norm;
+			b[2] = b[0];
+			a[0] = b[1];
+			a[1] = (1.f - K / Q + K2) * norm;
+		} break;
+
+		default: break;
+	}
+}
+
+
+/** A series of biquad sections in transposed direct form II, processing `T::size` channels in parallel.
+
+Each lane of `T` is an independent channel, and all sections of a channel run in series.
+Parameters are set per section, typically once per block, and processBlock() linearly interpolates the coefficients across the block to avoid zipper noise.
+
+For example, a 10-band EQ on 16 polyphonic voices is
+
+	TBiquadCascade<10> eq[4];
+
+with each element processing 4 voices.
+*/
+template <int SECTIONS, typename T = simd::float_4>
+struct TBiquadCascade {
+	typedef typename TBiquadFilter<>::Type Type;
+
+	struct Coefficients {
+		T b0, b1, b2, a1, a2;
+	};
+	/** Coefficients used by the last processed frame */
+	Coefficients coefficients[SECTIONS];
+	/** Coefficients reached at the end of the next block */
+	Coefficients targets[SECTIONS];
+	bool ramping = false;
+	/** Transposed direct form II state */
+	T s1[SECTIONS];
+	T s2[SECTIONS];
+
+	TBiquadCascade() {
+		for (int i = 0; i < SECTIONS; i++) {
+			setIdentity(i);
+		}
+		snap();
+		reset();
+	}
+
+	void reset() {
+		for (int i = 0; i < SECTIONS; i++) {
+			s1[i] = 0.f;
+			s2[i] = 0.f;
+		}
+	}
+
+	/** Sets the target coefficients of a section.
+	`b` holds b_0, b_1, b_2 and `a` holds a_1, a_2, as in IIRFilter.
+	*/
+	void setCoefficients(int section, const T* b, const T* a) {
+		Coefficients& c = targets[section];
+		c.b0 = b[0];
+		c.b1 = b[1];
+		c.b2 = b[2];
+		c.a1 = a[0];
+		c.a2 = a[1];
+		ramping = true;
+	}
+
+	/** Sets the target coefficients of a section for all channels.
+	See TBiquadFilter::setParameters() for the meaning of `f`, `Q`, and `V`.
+	*/
+	void setParameters(int section, Type type, T f, T Q, T V) {
+		T b[3];
+		T a[2];
+		computeBiquadCoefficients<T>(type, f, Q, V, b, a);
+		setCoefficients(section, b, a);
+	}
+
+	/** Makes a section pass its input unchanged. */
+	void setIdentity(int section) {
+		T b[3] = {1.f, 0.f, 0.f};
+		T a[2] = {0.f, 0.f};
+		setCoefficients(section, b, a);
+	}
+
+	/** Jumps to the target coefficients without interpolating. */
+	void snap() {
+		for (int i = 0; i < SECTIONS; i++) {
+			coefficients[i] = targets[i];
+		}
+		ramping = false;
+	}
+
+	/** Processes a single frame, jumping to the target coefficients if they have changed. */
+	T process(T in) {
+		if (ramping)
+			snap();
+		T x = in;
+		for (int i = 0; i < SECTIONS; i++) {
+			const Coefficients& c = coefficients[i];
+			T y = c.b0 * x + s1[i];
+			s1[i] = c.b1 * x - c.a1 * y + s2[i];
+			s2[i] = c.b2 * x - c.a2 * y;
+			x = y;
+		}
+		return x;
+	}
+
+	/** Processes `frames` frames, interpolating from the current to the target coefficients.
+	`in` and `out` may be the same buffer.
+	*/
+	void processBlock(const T* in, T* out, int frames) {
+		if (frames <= 0)
+			return;
+		// Run the block through each section in turn so its coefficients and state stay in registers
+		for (int i = 0; i < SECTIONS; i++) {
+			const T* sectionIn = (i == 0) ? in : out;
+			if (ramping)
+				processSection<true>(i, sectionIn, out, frames);
+			else
+				processSection<false>(i, sectionIn, out, frames);
+		}
+		if (ramping)
+			snap();
+	}
+
+private:
+	template <bool RAMP>
+	void processSection(int i, const T* in, T* out, int frames) {
+		Coefficients c = coefficients[i];
+		Coefficients d;
+		if (RAMP) {
+			const Coefficients& t = targets[i];
+			T r = 1.f / frames;
+			d.b0 = (t.b0 - c.b0) * r;
+			d.b1 = (t.b1 - c.b1) * r;
+			d.b2 = (t.b2 - c.b2) * r;
+			d.a1 = (t.a1 - c.a1) * r;
+			d.a2 = (t.a2 - c.a2) * r;
+		}
+		T z1 = s1[i];
+		T z2 = s2[i];
+		for (int j = 0; j < frames; j++) {
+			if (RAMP) {
+				c.b0 += d.b0;
+				c.b1 += d.b1;
+				c.b2 += d.b2;
+				c.a1 += d.a1;
+				c.a2 += d.a2;
+			}
+			T x = in[j];
+			T y = c.b0 * x + z1;
+			z1 = c.b1 * x - c.a1 * y + z2;
+			z2 = c.b2 * x - c.a2 * y;
+			out[j] = y;
+		}
+		s1[i] = z1;
+		s2[i] = z2;
+	}
+};
+
+template <int SECTIONS>
+using BiquadCascade = TBiquadCascade<SECTIONS>;
+
+
 } // namespace dsp
 } // namespace rack
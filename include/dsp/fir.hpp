@@ -1,7 +1,11 @@
 #pragma once
+#include <vector>
+
 #include <pffft.h>
 
 #include <dsp/common.hpp>
+#include <dsp/fft.hpp>
+#include <dsp/kernels.hpp>
 
 
 namespace rack {
@@ -41,7 +45,7 @@ struct RealTimeConvolver {
 	/** `blockSize` is the size of each FFT block. It should be >=32 and a power of 2. */
 	RealTimeConvolver(size_t blockSize) {
 		this->blockSize = blockSize;
-		pffft = pffft_new_setup(blockSize * 2, PFFFT_REAL);
+		pffft = acquireFftSetup(blockSize * 2, PFFFT_REAL);
 		outputTail = new float[blockSize];
 		std::memset(outputTail, 0, blockSize * sizeof(float));
 		tmpBlock = new float[blockSize * 2];
@@ -52,19 +56,15 @@ struct RealTimeConvolver {
 		setKernel(NULL, 0);
 		delete[] outputTail;
 		delete[] tmpBlock;
-		pffft_destroy_setup(pffft);
+		releaseFftSetup(pffft);
 	}
 
 	void setKernel(const float* kernel, size_t length) {
 		// Clear existing kernel
-		if (kernelFfts) {
-			pffft_aligned_free(kernelFfts);
-			kernelFfts = NULL;
-		}
-		if (inputFfts) {
-			pffft_aligned_free(inputFfts);
-			inputFfts = NULL;
-		}
+		releaseFftBuffer(kernelFfts, blockSize * 2 * kernelBlocks);
+		kernelFfts = NULL;
+		releaseFftBuffer(inputFfts, blockSize * 2 * kernelBlocks);
+		inputFfts = NULL;
 		kernelBlocks = 0;
 		inputPos = 0;
 
@@ -73,8 +73,8 @@ struct RealTimeConvolver {
 			kernelBlocks = (length - 1) / blockSize + 1;
 
 			// Allocate blocks
-			kernelFfts = (float*) pffft_aligned_malloc(sizeof(float) * blockSize * 2 * kernelBlocks);
-			inputFfts = (float*) pffft_aligned_malloc(sizeof(float) * blockSize * 2 * kernelBlocks);
+			kernelFfts = acquireFftBuffer(blockSize * 2 * kernelBlocks);
+			inputFfts = acquireFftBuffer(blockSize * 2 * kernelBlocks);
 			std::memset(inputFfts, 0, sizeof(float) * blockSize * 2 * kernelBlocks);
 
 			for (size_t i = 0; i < kernelBlocks; i++) {
@@ -110,7 +110,7 @@ struct RealTimeConvolver {
 		// Note: This is the CPU bottleneck loop
 		for (size_t i = 0; i < kernelBlocks; i++) {
 			size_t pos = (inputPos - i + kernelBlocks) % kernelBlocks;
-			pffft_zconvolve_accumulate(pffft, &kernelFfts[blockSize * 2 * i], &inputFfts[blockSize * 2 * pos], tmpBlock, 1.f);
+			fftConvolveAccumulate(pffft, blockSize * 2, &kernelFfts[blockSize * 2 * i], &inputFfts[blockSize * 2 * pos], tmpBlock, 1.f);
 		}
 		// Compute output
 		pffft_transform(pffft, tmpBlock, tmpBlock, NULL, PFFFT_BACKWARD);
@@ -132,5 +132,171 @@ struct RealTimeConvolver {
 };
 
 
+/** Convolves a matrix of kernels, routing each of `numInputs` inputs to each of `numOutputs` outputs.
+Each input is transformed once per block, and its frequency-domain delay line is shared by all kernels reading from it.
+Each output accumulates its routes in the frequency domain and needs one inverse transform.
+For example, a true-stereo reverb is 2 inputs x 2 outputs, and a polyphonic convolver is a diagonal matrix.
+*/
+struct MatrixConvolver {
+	struct Route {
+		// `blocks` contiguous FFT blocks of size `blockSize * 2`
+		float* kernelFfts = NULL;
+		size_t blocks = 0;
+	};
+
+	size_t blockSize;
+	int numInputs;
+	int numOutputs;
+	/** Indexed by [input * numOutputs + output] */
+	std::vector<Route> routes;
+	/** Delay line of `maxBlocks` input FFTs for each input */
+	std::vector<float*> inputFfts;
+	std::vector<float*> outputTails;
+	float* tmpBlock = NULL;
+	size_t maxBlocks = 0;
+	size_t inputPos = 0;
+	PFFFT_Setup* pffft;
+
+	/** `blockSize` is the size of each FFT block. It should be >=32 and a power of 2. */
+	MatrixConvolver(size_t blockSize, int numInputs, int numOutputs) {
+		this->blockSize = blockSize;
+		this->numInputs = numInputs;
+		this->numOutputs = numOutputs;
+		pffft = acquireFftSetup(blockSize * 2, PFFFT_REAL);
+		routes.resize(numInputs * numOutputs);
+		inputFfts.resize(numInputs, NULL);
+		for (int o = 0; o < numOutputs; o++) {
+			float* tail = new float[blockSize];
+			std::memset(tail, 0, blockSize * sizeof(float));
+			outputTails.push_back(tail);
+		}
+		tmpBlock = acquireFftBuffer(blockSize * 2);
+	}
+
+	~MatrixConvolver() {
+		for (int i = 0; i < numInputs; i++) {
+			for (int o = 0; o < numOutputs; o++) {
+				setKernel(i, o, NULL, 0);
+			}
+		}
+		for (float* tail : outputTails) {
+			delete[] tail;
+		}
+		releaseFftBuffer(tmpBlock, blockSize * 2);
+		releaseFftSetup(pffft);
+	}
+
+	/** Sets the kernel from `input` to `output`, or removes the route if `kernel` is NULL.
+	Not real-time safe. Clears the input delay lines if the longest kernel length changes.
+	*/
+	void setKernel(int input, int output, const float* kernel, size_t length) {
+		Route& route = routes[input * numOutputs + output];
+		releaseFftBuffer(route.kernelFfts, blockSize * 2 * route.blocks);
+		route.kernelFfts = NULL;
+		route.blocks = 0;
+
+		if (kernel && length > 0) {
+			// Round up to the nearest factor of `blockSize`
+			route.blocks = (length - 1) / blockSize + 1;
+			route.kernelFfts = acquireFftBuffer(blockSize * 2 * route.blocks);
+			for (size_t i = 0; i < route.blocks; i++) {
+				// Pad each block with zeros
+				std::memset(tmpBlock, 0, sizeof(float) * blockSize * 2);
+				size_t len = std::min(blockSize, length - i * blockSize);
+				std::memcpy(tmpBlock, &kernel[i * blockSize], sizeof(float) * len);
+				pffft_transform(pffft, tmpBlock, &route.kernelFfts[blockSize * 2 * i], NULL, PFFFT_FORWARD);
+			}
+		}
+
+		// Resize input delay lines to the longest kernel
+		size_t newMaxBlocks = 0;
+		for (const Route& r : routes) {
+			newMaxBlocks = std::max(newMaxBlocks, r.blocks);
+		}
+		if (newMaxBlocks != maxBlocks) {
+			inputPos = 0;
+			for (float*& ffts : inputFfts) {
+				releaseFftBuffer(ffts, blockSize * 2 * maxBlocks);
+				ffts = NULL;
+				if (newMaxBlocks > 0) {
+					ffts = acquireFftBuffer(blockSize * 2 * newMaxBlocks);
+					std::memset(ffts, 0, sizeof(float) * blockSize * 2 * newMaxBlocks);
+				}
+			}
+			maxBlocks = newMaxBlocks;
+		}
+	}
+
+	/** Convolves one block.
+	`inputs` and `outputs` are arrays of `numInputs` and `numOutputs` pointers to buffers of size `blockSize`.
+	*/
+	void processBlock(const float* const* inputs, float* const* outputs) {
+		if (maxBlocks == 0) {
+			for (int o = 0; o < numOutputs; o++) {
+				std::memset(outputs[o], 0, sizeof(float) * blockSize);
+			}
+			return;
+		}
+
+		// Transform each input once
+		inputPos = (inputPos + 1) % maxBlocks;
+		for (int i = 0; i < numInputs; i++) {
+			std::memset(tmpBlock, 0, sizeof(float) * blockSize * 2);
+			std::memcpy(tmpBlock, inputs[i], sizeof(float) * blockSize);
+			pffft_transform(pffft, tmpBlock, &inputFfts[i][blockSize * 2 * inputPos], NULL, PFFFT_FORWARD);
+		}
+
+		float scale = 1.f / (blockSize * 2);
+		for (int o = 0; o < numOutputs; o++) {
+			// Accumulate all routes to this output in the frequency domain
+			std::memset(tmpBlock, 0, sizeof(float) * blockSize * 2);
+			for (int i = 0; i < numInputs; i++) {
+				const Route& route = routes[i * numOutputs + o];
+				for (size_t b = 0; b < route.blocks; b++) {
+					size_t pos = (inputPos + maxBlocks - b) % maxBlocks;
+					fftConvolveAccumulate(pffft, blockSize * 2, &route.kernelFfts[blockSize * 2 * b], &inputFfts[i][blockSize * 2 * pos], tmpBlock, 1.f);
+				}
+			}
+			pffft_transform(pffft, tmpBlock, tmpBlock, NULL, PFFFT_BACKWARD);
+			// Overlap-add with tail of last block, and scale based on FFT
+			float* tail = outputTails[o];
+			for (size_t j = 0; j < blockSize; j++) {
+				outputs[o][j] = (tmpBlock[j] + tail[j]) * scale;
+				tail[j] = tmpBlock[j + blockSize];
+			}
+		}
+	}
+};
+
+
+/** Convolves a long kernel at low latency using non-uniform partitions.
+
+The start of the kernel is convolved in processBlock() with partitions of `blockSize`, like RealTimeConvolver.
+The rest is split into partitions that double in size up to `maxPartitionSize`, which are convolved on a background thread.
+A partition of size N starts 2N samples into the kernel, so each background job has a deadline of N samples before its output is needed.
+Each partition size has its own background thread, at a lower priority for larger partitions, so the OS preempts a long job when a shorter one is due.
+If a job misses its deadline, processBlock() waits for it.
+
+`maxPartitionSize` is the latency-vs-CPU knob: latency is always `blockSize`, but larger maximum partitions need fewer spectral multiplications per sample for long kernels, at the cost of memory and burstier background work.
+*/
+struct PartitionedConvolver {
+	struct Internal;
+	Internal* internal;
+
+	/** `blockSize` and `maxPartitionSize` should be >=32 and powers of 2. */
+	PartitionedConvolver(size_t blockSize, size_t maxPartitionSize = 8192);
+	~PartitionedConvolver();
+	/** Not real-time safe. Stops the background threads while partitions are rebuilt. */
+	void setKernel(const float* kernel, size_t length);
+	/** Applies the kernel to `input`.
+	input and output must be of size `blockSize`.
+	*/
+	void processBlock(const float* input, float* output);
+	size_t getBlockSize();
+	/** Returns the number of times processBlock() had to wait for a background thread. */
+	uint64_t getLateCount();
+};
+
+
 } // namespace dsp
 } // namespace rack
@@ -0,0 +1,48 @@
+#pragma once
+#include <pffft.h>
+
+#include <dsp/common.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/** Block kernels compiled into libRack for several instruction sets.
+Rack is built for a baseline instruction set so the binary runs on any supported CPU.
+These kernels are also compiled for wider instruction sets, and each call is dispatched to the widest one the CPU supports.
+*/
+
+enum CpuLevel {
+	/** SSE4.2 on x64, or NEON on ARM64 */
+	CPU_LEVEL_BASELINE,
+	/** AVX2 and FMA */
+	CPU_LEVEL_AVX2,
+	/** AVX-512F */
+	CPU_LEVEL_AVX512,
+	CPU_LEVELS_LEN
+};
+
+/** Returns the widest instruction set supported by the CPU. */
+CpuLevel getCpuLevelSupported();
+/** Returns the instruction set the kernels are currently dispatched to. */
+CpuLevel getCpuLevel();
+/** Dispatches kernels to an instruction set, limited to the ones supported by the CPU.
+Useful for comparing results and performance between instruction sets.
+Not thread-safe. Call before starting the engine.
+*/
+void setCpuLevel(CpuLevel level);
+std::string getCpuLevelName(CpuLevel level);
+
+/** Copies `len` values from `in` to `out`, replacing infinite and NaN values with 0. */
+void copyFinite(const float* in, float* out, int len);
+
+/** Multiplies the spectra `a` and `b` of a real PFFFT setup of `length`, and adds the product times `scale` to `ab`.
+Equivalent to `pffft_zconvolve_accumulate()`, but uses wider instructions if available.
+Spectra are in the unordered format of `pffft_transform()`.
+*/
+void fftConvolveAccumulate(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale);
+
+
+} // namespace dsp
+} // namespace rack
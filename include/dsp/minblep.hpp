@@ -15,34 +15,114 @@ https://www.cs.cmu.edu/~eli/papers/icmc01-hardsync.pdf
 void minBlepImpulse(int z, int o, float* output);
 
 
+/** Step residual tables of a MinBlepGenerator, shared by all generators with the same `Z` and `O`.
+*/
+template <int Z, int O>
+struct MinBlepTable {
+	/** Residual of the step at each phase, `impulse[j * O + k] - 1`, laid out as `[k][j]` so each phase is a contiguous row of `2 * Z` taps. */
+	alignas(16) float table[O + 1][2 * Z];
+	/** Difference between adjacent phase rows, for linear interpolation between phases */
+	alignas(16) float tableDelta[O][2 * Z];
+
+	MinBlepTable() {
+		float impulse[2 * Z * O + 1];
+		minBlepImpulse(Z, O, impulse);
+		impulse[2 * Z * O] = 1.f;
+		for (int k = 0; k <= O; k++) {
+			for (int j = 0; j < 2 * Z; j++) {
+				int index = j * O + k;
+				table[k][j] = (index <= 2 * Z * O) ? impulse[index] - 1.f : 0.f;
+			}
+		}
+		for (int k = 0; k < O; k++) {
+			for (int j = 0; j < 2 * Z; j++) {
+				tableDelta[k][j] = table[k + 1][j] - table[k][j];
+			}
+		}
+	}
+
+	/** Returns the shared table, building it on first use. Thread-safe. */
+	static const MinBlepTable& get() {
+		static const MinBlepTable table;
+		return table;
+	}
+};
+
+
 template <int Z, int O, typename T = float>
 struct MinBlepGenerator {
-	T buf[2 * Z] = {};
+	/** Linear buffer of length `4 * Z`.
+	Discontinuities are written contiguously to `buf[pos, pos + 2 * Z)`, and the upper half is shifted down when `pos` reaches `2 * Z`, so no index is wrapped.
+	*/
+	T buf[4 * Z] = {};
 	int pos = 0;
-	float impulse[2 * Z * O + 1];
+	/** Not owned */
+	const MinBlepTable<Z, O>* table;
 
 	MinBlepGenerator() {
-		minBlepImpulse(Z, O, impulse);
-		impulse[2 * Z * O] = 1.f;
+		table = &MinBlepTable<Z, O>::get();
 	}
 
 	/** Places a discontinuity with magnitude `x` at -1 < p <= 0 relative to the current frame */
 	void insertDiscontinuity(float p, T x) {
 		if (!(-1 < p && p <= 0))
 			return;
-		for (int j = 0; j < 2 * Z; j++) {
-			float minBlepIndex = ((float)j - p) * O;
-			int index = (pos + j) % (2 * Z);
-			buf[index] += x * (-1.f + math::interpolateLinear(impulse, minBlepIndex));
+		float phase = -p * O;
+		int k = std::min((int) phase, O - 1);
+		float t = phase - k;
+		accumulate(&buf[pos], table->table[k], table->tableDelta[k], t, x);
+	}
+
+	/** Places `count` discontinuities in the current frame, e.g. a reset and a pulse-width edge of the same oscillator.
+	Equivalent to calling insertDiscontinuity() for each.
+	*/
+	void insertDiscontinuities(const float* p, const T* x, int count) {
+		T* dst = &buf[pos];
+		for (int i = 0; i < count; i++) {
+			if (!(-1 < p[i] && p[i] <= 0))
+				continue;
+			float phase = -p[i] * O;
+			int k = std::min((int) phase, O - 1);
+			float t = phase - k;
+			accumulate(dst, table->table[k], table->tableDelta[k], t, x[i]);
 		}
 	}
 
 	T process() {
 		T v = buf[pos];
-		buf[pos] = T(0);
-		pos = (pos + 1) % (2 * Z);
+		pos++;
+		if (pos >= 2 * Z) {
+			// Shift the pending residual down and clear the upper half
+			for (int j = 0; j < 2 * Z; j++) {
+				buf[j] = buf[2 * Z + j];
+				buf[2 * Z + j] = T(0);
+			}
+			pos = 0;
+		}
 		return v;
 	}
+
+private:
+	template <typename U>
+	static void accumulate(U* dst, const float* row, const float* delta, float t, U x) {
+		for (int j = 0; j < 2 * Z; j++) {
+			dst[j] += x * (row[j] + t * delta[j]);
+		}
+	}
+
+	static void accumulate(float* dst, const float* row, const float* delta, float t, float x) {
+		int j = 0;
+		for (; j + 4 <= 2 * Z; j += 4) {
+			simd::float_4 r = simd::float_4::load(&row[j]);
+			simd::float_4 d = simd::float_4::load(&delta[j]);
+			simd::float_4 y = simd::float_4::load(&dst[j]);
+			y += x * (r + t * d);
+			y.store(&dst[j]);
+		}
+		for (; j < 2 * Z; j++) {
+			dst[j] += x * (row[j] + t * delta[j]);
+		}
+	}
 };
 
 
@@ -87,5 +87,224 @@ void stepRK4(T t, T dt, T x[], int len, F f) {
 }
 
 
+
+/** Batch variants with the system size `LEN` given at compile time.
+Stages are fixed-size arrays the compiler can keep in registers and unroll, rather than variable-length arrays.
+
+To integrate many voices at once, use a SIMD type for T and store the voices' states interleaved, so `x[i]` holds state variable i of 4 voices.
+For example, a 2-pole filter of 16 voices can be stepped in 4 calls with T = simd::float_4.
+
+	simd::float_4 x[4][2] = {};
+	for (int c = 0; c < 16; c += 4) {
+		simd::float_4 cutoff = inputs[CUTOFF_INPUT].getPolyVoltageSimd<simd::float_4>(c);
+		rack::dsp::stepRK4<2>(simd::float_4(0.f), simd::float_4(dt), x[c / 4], [&](simd::float_4 t, const simd::float_4 x[], simd::float_4 dxdt[]) {
+			dxdt[0] = ...;
+			dxdt[1] = ...;
+		});
+	}
+
+*/
+
+/** Solves an ODE system of size LEN using the 1st order Euler method */
+template <int LEN, typename T, typename F>
+void stepEuler(T t, T dt, T x[], F f) {
+	T k[LEN];
+
+	f(t, x, k);
+	for (int i = 0; i < LEN; i++) {
+		x[i] += dt * k[i];
+	}
+}
+
+/** Solves an ODE system of size LEN using the 2nd order Runge-Kutta method */
+template <int LEN, typename T, typename F>
+void stepRK2(T t, T dt, T x[], F f) {
+	T k1[LEN];
+	T k2[LEN];
+	T yi[LEN];
+	T halfDt = dt * T(0.5f);
+
+	f(t, x, k1);
+
+	for (int i = 0; i < LEN; i++) {
+		yi[i] = x[i] + halfDt * k1[i];
+	}
+	f(t + halfDt, yi, k2);
+
+	for (int i = 0; i < LEN; i++) {
+		x[i] += dt * k2[i];
+	}
+}
+
+/** Solves an ODE system of size LEN using the 4th order Runge-Kutta method */
+template <int LEN, typename T, typename F>
+void stepRK4(T t, T dt, T x[], F f) {
+	T k1[LEN];
+	T k2[LEN];
+	T k3[LEN];
+	T k4[LEN];
+	T yi[LEN];
+	T halfDt = dt * T(0.5f);
+
+	f(t, x, k1);
+
+	for (int i = 0; i < LEN; i++) {
+		yi[i] = x[i] + halfDt * k1[i];
+	}
+	f(t + halfDt, yi, k2);
+
+	for (int i = 0; i < LEN; i++) {
+		yi[i] = x[i] + halfDt * k2[i];
+	}
+	f(t + halfDt, yi, k3);
+
+	for (int i = 0; i < LEN; i++) {
+		yi[i] = x[i] + dt * k3[i];
+	}
+	f(t + dt, yi, k4);
+
+	T sixthDt = dt * T(1.f / 6);
+	for (int i = 0; i < LEN; i++) {
+		x[i] += sixthDt * (k1[i] + T(2) * (k2[i] + k3[i]) + k4[i]);
+	}
+}
+
+
+/** Returns the largest element of a SIMD vector. */
+template <typename T>
+float maxElement(T x) {
+	float m = x[0];
+	for (int i = 1; i < T::size; i++) {
+		m = std::fmax(m, x[i]);
+	}
+	return m;
+}
+
+inline float maxElement(float x) {
+	return x;
+}
+
+
+/** Solves an ODE system of size LEN using the adaptive Dormand-Prince 5(4) method, with a bounded number of substeps.
+
+Each step() divides `dt` into substeps whose size is chosen from the embedded 4th order error estimate, so smooth passages cost one substep and sharp transients get several.
+The substep size is kept between calls, so a system that needed small substeps on the last sample starts with them on the next.
+Because the function's inputs usually change every sample, the FSAL (first same as last) derivative is only reused within a call.
+
+Each attempted substep costs 6 evaluations of `f`, plus 1 for the first, so a step costs at most `1 + 6 * maxSteps` evaluations.
+When the last attempt is reached, it covers the rest of `dt` and is accepted regardless of its error, like a fixed-step 5th order method.
+
+If T is a SIMD type, all elements share the substep size, which is chosen for the element with the largest error.
+*/
+template <int LEN, typename T = float>
+struct TDormandPrince {
+	/** Tolerance of each substep's local error, relative to `absTolerance + relTolerance * |x|` */
+	float absTolerance = 1e-4f;
+	float relTolerance = 1e-4f;
+	/** Maximum number of attempted substeps per step */
+	int maxSteps = 4;
+	/** Size of the next substep as a fraction of `dt` */
+	float stepRatio = 1.f;
+
+	void reset() {
+		stepRatio = 1.f;
+	}
+
+	/** Advances the state `x` from `t` to `t + dt`.
+	Returns the number of substeps attempted.
+	*/
+	template <typename F>
+	int step(float t, float dt, T x[], F f) {
+		// Butcher tableau
+		const float c2 = 1.f / 5, c3 = 3.f / 10, c4 = 4.f / 5, c5 = 8.f / 9;
+		const float a21 = 1.f / 5;
+		const float a31 = 3.f / 40, a32 = 9.f / 40;
+		const float a41 = 44.f / 45, a42 = -56.f / 15, a43 = 32.f / 9;
+		const float a51 = 19372.f / 6561, a52 = -25360.f / 2187, a53 = 64448.f / 6561, a54 = -212.f / 729;
+		const float a61 = 9017.f / 3168, a62 = -355.f / 33, a63 = 46732.f / 5247, a64 = 49.f / 176, a65 = -5103.f / 18656;
+		// 5th order weights
+		const float b1 = 35.f / 384, b3 = 500.f / 1113, b4 = 125.f / 192, b5 = -2187.f / 6784, b6 = 11.f / 84;
+		// Difference between the 5th and 4th order weights
+		const float e1 = 71.f / 57600, e3 = -71.f / 16695, e4 = 71.f / 1920, e5 = -17253.f / 339200, e6 = 22.f / 525, e7 = -1.f / 40;
+
+		T k1[LEN], k2[LEN], k3[LEN], k4[LEN], k5[LEN], k6[LEN], k7[LEN];
+		T yi[LEN];
+		T y[LEN];
+
+		float remaining = dt;
+		float h = dt * stepRatio;
+		f(T(t), x, k1);
+
+		int steps = 0;
+		while (true) {
+			steps++;
+			// The last attempt is accepted regardless of its error
+			bool forced = (steps >= maxSteps);
+			// Stretch a substep that would leave a sliver of the interval
+			bool last = forced || (h * 1.01f >= remaining);
+			if (last)
+				h = remaining;
+
+			for (int i = 0; i < LEN; i++)
+				yi[i] = x[i] + h * (a21 * k1[i]);
+			f(T(t + c2 * h), yi, k2);
+			for (int i = 0; i < LEN; i++)
+				yi[i] = x[i] + h * (a31 * k1[i] + a32 * k2[i]);
+			f(T(t + c3 * h), yi, k3);
+			for (int i = 0; i < LEN; i++)
+				yi[i] = x[i] + h * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+			f(T(t + c4 * h), yi, k4);
+			for (int i = 0; i < LEN; i++)
+				yi[i] = x[i] + h * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i] + a54 * k4[i]);
+			f(T(t + c5 * h), yi, k5);
+			for (int i = 0; i < LEN; i++)
+				yi[i] = x[i] + h * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i] + a64 * k4[i] + a65 * k5[i]);
+			f(T(t + h), yi, k6);
+			for (int i = 0; i < LEN; i++)
+				y[i] = x[i] + h * (b1 * k1[i] + b3 * k3[i] + b4 * k4[i] + b5 * k5[i] + b6 * k6[i]);
+			f(T(t + h), y, k7);
+
+			// Largest local error relative to its tolerance
+			T err = 0.f;
+			for (int i = 0; i < LEN; i++) {
+				T e = h * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i] + e6 * k6[i] + e7 * k7[i]);
+				T tolerance = absTolerance + relTolerance * simd::fmax(simd::fabs(x[i]), simd::fabs(y[i]));
+				err = simd::fmax(err, simd::fabs(e) / tolerance);
+			}
+			float maxErr = maxElement(err);
+
+			// Standard step size controller with safety factor, limited to [1/5, 5] times the current step
+			float scale = 5.f;
+			if (maxErr > 0.f)
+				scale = math::clamp(0.9f * std::pow(maxErr, -1.f / 5), 0.2f, 5.f);
+			// NaN errors reject the substep and shrink the next one
+			if (!(maxErr <= 1.f) && !forced) {
+				h *= std::isfinite(maxErr) ? scale : 0.2f;
+				continue;
+			}
+
+			// Accept substep
+			for (int i = 0; i < LEN; i++) {
+				x[i] = y[i];
+				k1[i] = k7[i];
+			}
+			t += h;
+			remaining -= h;
+			h *= scale;
+			if (last)
+				break;
+		}
+
+		// Substeps shorter than dt / maxSteps would run out of attempts before reaching the end of the next step
+		if (std::isfinite(h))
+			stepRatio = math::clamp(h / dt, 1.f / maxSteps, 1.f);
+		return steps;
+	}
+};
+
+template <int LEN>
+using DormandPrince = TDormandPrince<LEN, float>;
+
+
 } // namespace dsp
 } // namespace rack
@@ -1,4 +1,8 @@
 #pragma once
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 #include <speex/speex_resampler.h>
 
 #include <dsp/common.hpp>
@@ -11,7 +15,11 @@ namespace rack {
 namespace dsp {
 
 
-/** Resamples by a fixed rational factor. */
+/** Resamples by a rational factor, optionally corrected by a continuously variable ratio.
+
+Changing the rates, quality, or number of channels reuses the existing resampler state, so it is safe to call these every block.
+The state is allocated for MAX_CHANNELS once and only recreated if Speex fails to update it.
+*/
 template <int MAX_CHANNELS>
 struct SampleRateConverter {
 	SpeexResamplerState* st = NULL;
@@ -19,6 +27,12 @@ struct SampleRateConverter {
 	int quality = SPEEX_RESAMPLER_QUALITY_DEFAULT;
 	int inRate = 44100;
 	int outRate = 44100;
+	/** Multiplier of the output/input ratio, for clock drift correction */
+	double ratioCorrection = 1.0;
+	/** Whether to bypass the resampler when the effective ratio is exactly 1 */
+	bool bypassEnabled = true;
+	/** Whether the resampler is bypassed because the effective ratio is exactly 1 */
+	bool bypass = true;
 
 	SampleRateConverter() {
 		refreshState();
@@ -32,10 +46,7 @@ struct SampleRateConverter {
 	/** Sets the number of channels to actually process. This can be at most MAX_CHANNELS. */
 	void setChannels(int channels) {
 		assert(channels <= MAX_CHANNELS);
-		if (channels == this->channels)
-			return;
 		this->channels = channels;
-		refreshState();
 	}
 
 	/** From 0 (worst, fastest) to 10 (best, slowest) */
@@ -43,7 +54,11 @@ struct SampleRateConverter {
 		if (quality == this->quality)
 			return;
 		this->quality = quality;
-		refreshState();
+		if (st) {
+			int err = speex_resampler_set_quality(st, quality);
+			if (err)
+				refreshState();
+		}
 	}
 
 	void setRates(int inRate, int outRate) {
@@ -51,7 +66,59 @@ struct SampleRateConverter {
 			return;
 		this->inRate = inRate;
 		this->outRate = outRate;
-		refreshState();
+		updateRate();
+	}
+
+	/** Scales the output/input ratio by `ratioCorrection`, without resetting the resampler.
+	Use this to track the clock drift between two devices, e.g. `ratioCorrection = 1.0001` produces 0.01% more output frames.
+	Resolution is about 1 ppm.
+	Each change makes Speex recompute its interpolation filter, and may reallocate it, so quantize the correction and change it rarely rather than every block.
+	*/
+	void setRatioCorrection(double ratioCorrection) {
+		if (ratioCorrection == this->ratioCorrection)
+			return;
+		this->ratioCorrection = ratioCorrection;
+		updateRate();
+	}
+
+	/** Disable the bypass if the ratio correction may return to exactly 1 while audio is running.
+	Leaving the bypass restarts the filter from silence, which is audible.
+	*/
+	void setBypassEnabled(bool bypassEnabled) {
+		if (bypassEnabled == this->bypassEnabled)
+			return;
+		this->bypassEnabled = bypassEnabled;
+		updateRate();
+	}
+
+	/** Returns the effective number of output frames per input frame. */
+	double getRatio() {
+		return (double) outRate / inRate * ratioCorrection;
+	}
+
+	void updateRate() {
+		bool wasBypassed = bypass;
+		bypass = bypassEnabled && (inRate == outRate && ratioCorrection == 1.0);
+		if (bypass || !st)
+			return;
+		int err;
+		if (ratioCorrection == 1.0) {
+			err = speex_resampler_set_rate(st, inRate, outRate);
+		}
+		else {
+			// Speex ratios are num/den = input/output. Scale the denominator for ~1 ppm resolution without overflowing 32 bits.
+			const spx_uint32_t scale = 16;
+			spx_uint32_t den = (spx_uint32_t) outRate * scale;
+			spx_uint32_t num = (spx_uint32_t) std::round((double) inRate * scale / ratioCorrection);
+			err = speex_resampler_set_rate_frac(st, num, den, inRate, outRate);
+		}
+		if (err) {
+			refreshState();
+			return;
+		}
+		// Don't resample stale history from before the bypass
+		if (wasBypassed)
+			speex_resampler_reset_mem(st);
 	}
 
 	void refreshState() {
@@ -60,26 +127,28 @@ struct SampleRateConverter {
 			st = NULL;
 		}
 
-		if (channels > 0 && inRate != outRate) {
-			int err;
-			st = speex_resampler_init(channels, inRate, outRate, quality, &err);
-			(void) err;
-		}
+		int err;
+		st = speex_resampler_init(MAX_CHANNELS, inRate, outRate, quality, &err);
+		(void) err;
+		bypass = true;
+		updateRate();
 	}
 
-	void process(const float* in, int inStride, int* inFrames, float* out, int outStride, int* outFrames) {
+	/** Resamples channels `[firstChannel, firstChannel + numChannels)`.
+	Channels have independent state, so disjoint channel ranges may be processed concurrently on different threads, as long as the rates, quality, and strides are not changed meanwhile.
+	*/
+	void processChannels(int firstChannel, int numChannels, const float* in, int inStride, int* inFrames, float* out, int outStride, int* outFrames) {
 		assert(in);
 		assert(inFrames);
 		assert(out);
 		assert(outFrames);
+		assert(firstChannel + numChannels <= MAX_CHANNELS);
 
-		if (st) {
-			speex_resampler_set_input_stride(st, inStride);
-			speex_resampler_set_output_stride(st, outStride);
+		if (st && !bypass) {
 			// Resample each channel at a time
-			spx_uint32_t inLen = 0;
-			spx_uint32_t outLen = 0;
-			for (int c = 0; c < channels; c++) {
+			spx_uint32_t inLen = *inFrames;
+			spx_uint32_t outLen = *outFrames;
+			for (int c = firstChannel; c < firstChannel + numChannels; c++) {
 				inLen = *inFrames;
 				outLen = *outFrames;
 				int err = speex_resampler_process_float(st, c, &in[c], &inLen, &out[c], &outLen);
@@ -91,9 +160,14 @@ struct SampleRateConverter {
 		else {
 			// Simply copy the buffer without conversion
 			int frames = std::min(*inFrames, *outFrames);
-			for (int i = 0; i < frames; i++) {
-				for (int c = 0; c < channels; c++) {
-					out[outStride * i + c] = in[inStride * i + c];
+			if (inStride == outStride && firstChannel == 0 && numChannels == inStride) {
+				std::memcpy(out, in, sizeof(float) * frames * inStride);
+			}
+			else {
+				for (int i = 0; i < frames; i++) {
+					for (int c = firstChannel; c < firstChannel + numChannels; c++) {
+						out[outStride * i + c] = in[inStride * i + c];
+					}
 				}
 			}
 			*inFrames = frames;
@@ -101,82 +175,421 @@ struct SampleRateConverter {
 		}
 	}
 
+	/** Sets the strides of the buffers passed to processChannels().
+	Call this before processing channel ranges concurrently.
+	*/
+	void setStrides(int inStride, int outStride) {
+		if (st) {
+			speex_resampler_set_input_stride(st, inStride);
+			speex_resampler_set_output_stride(st, outStride);
+		}
+	}
+
+	void process(const float* in, int inStride, int* inFrames, float* out, int outStride, int* outFrames) {
+		setStrides(inStride, outStride);
+		processChannels(0, channels, in, inStride, inFrames, out, outStride, outFrames);
+	}
+
 	void process(const Frame<MAX_CHANNELS>* in, int* inFrames, Frame<MAX_CHANNELS>* out, int* outFrames) {
 		process((const float*) in, MAX_CHANNELS, inFrames, (float*) out, MAX_CHANNELS, outFrames);
 	}
 };
 
 
-/** Downsamples by an integer factor. */
+/** Returns the dot product of a float kernel and a history buffer of length LEN.
+The buffers are contiguous and unwrapped, so the loop has no index arithmetic.
+*/
+template <int LEN, typename T>
+struct PolyphaseDot {
+	static T process(const float* kernel, const T* x) {
+		// T is a SIMD vector, so each tap is already processed in parallel across voices.
+		T y = 0.f;
+		for (int i = 0; i < LEN; i++) {
+			y += kernel[i] * x[i];
+		}
+		return y;
+	}
+};
+
+template <int LEN>
+struct PolyphaseDot<LEN, float> {
+	static float process(const float* kernel, const float* x) {
+		// Vectorize across taps
+		simd::float_4 y4 = 0.f;
+		int i = 0;
+		for (; i + 4 <= LEN; i += 4) {
+			y4 += simd::float_4::load(&kernel[i]) * simd::float_4::load(&x[i]);
+		}
+		float y = (y4[0] + y4[1]) + (y4[2] + y4[3]);
+		for (; i < LEN; i++) {
+			y += kernel[i] * x[i];
+		}
+		return y;
+	}
+};
+
+
+/** Downsamples by an integer factor.
+T can be `float` or a SIMD type like `simd::float_4` to decimate multiple voices at once.
+*/
 template <int OVERSAMPLE, int QUALITY, typename T = float>
 struct Decimator {
-	T inBuffer[OVERSAMPLE * QUALITY];
-	float kernel[OVERSAMPLE * QUALITY];
+	static constexpr int LEN = OVERSAMPLE * QUALITY;
+	/** Input history, stored twice so the last LEN samples are always contiguous */
+	T inBuffer[2 * LEN];
+	/** Kernel in reverse order, so it lines up with the history from oldest to newest */
+	alignas(16) float kernel[LEN];
 	int inIndex;
 
 	Decimator(float cutoff = 0.9f) {
-		boxcarLowpassIR(kernel, OVERSAMPLE * QUALITY, cutoff * 0.5f / OVERSAMPLE);
-		blackmanHarrisWindow(kernel, OVERSAMPLE * QUALITY);
+		float ir[LEN];
+		boxcarLowpassIR(ir, LEN, cutoff * 0.5f / OVERSAMPLE);
+		blackmanHarrisWindow(ir, LEN);
+		for (int i = 0; i < LEN; i++) {
+			kernel[i] = ir[LEN - 1 - i];
+		}
 		reset();
 	}
 	void reset() {
 		inIndex = 0;
-		std::memset(inBuffer, 0, sizeof(inBuffer));
+		std::fill(std::begin(inBuffer), std::end(inBuffer), T(0.f));
 	}
 	/** `in` must be length OVERSAMPLE */
-	T process(T* in) {
-		// Copy input to buffer
-		std::memcpy(&inBuffer[inIndex], in, OVERSAMPLE * sizeof(T));
+	T process(const T* in) {
+		// Copy input to both halves of buffer
+		std::copy(in, in + OVERSAMPLE, &inBuffer[inIndex]);
+		std::copy(in, in + OVERSAMPLE, &inBuffer[inIndex + LEN]);
 		// Advance index
 		inIndex += OVERSAMPLE;
-		inIndex %= OVERSAMPLE * QUALITY;
-		// Perform naive convolution
-		T out = 0.f;
-		for (int i = 0; i < OVERSAMPLE * QUALITY; i++) {
-			int index = inIndex - 1 - i;
-			index = (index + OVERSAMPLE * QUALITY) % (OVERSAMPLE * QUALITY);
-			out += kernel[i] * inBuffer[index];
-		}
-		return out;
+		if (inIndex >= LEN)
+			inIndex = 0;
+		// The last LEN samples from oldest to newest
+		const T* x = &inBuffer[inIndex];
+		return PolyphaseDot<LEN, T>::process(kernel, x);
 	}
 };
 
 
-/** Upsamples by an integer factor. */
-template <int OVERSAMPLE, int QUALITY>
+/** Upsamples by an integer factor.
+Uses a polyphase filter, so each output sample only convolves the QUALITY nonzero taps of the zero-stuffed input.
+T can be `float` or a SIMD type like `simd::float_4` to upsample multiple voices at once.
+*/
+template <int OVERSAMPLE, int QUALITY, typename T = float>
 struct Upsampler {
-	float inBuffer[QUALITY];
-	float kernel[OVERSAMPLE * QUALITY];
+	/** Input history, stored twice so the last QUALITY samples are always contiguous */
+	T inBuffer[2 * QUALITY];
+	/** Kernel split into OVERSAMPLE phases of QUALITY taps, each in reverse order and scaled by OVERSAMPLE to preserve gain */
+	alignas(16) float kernel[OVERSAMPLE][QUALITY];
 	int inIndex;
 
 	Upsampler(float cutoff = 0.9f) {
-		boxcarLowpassIR(kernel, OVERSAMPLE * QUALITY, cutoff * 0.5f / OVERSAMPLE);
-		blackmanHarrisWindow(kernel, OVERSAMPLE * QUALITY);
+		float ir[OVERSAMPLE * QUALITY];
+		boxcarLowpassIR(ir, OVERSAMPLE * QUALITY, cutoff * 0.5f / OVERSAMPLE);
+		blackmanHarrisWindow(ir, OVERSAMPLE * QUALITY);
+		for (int i = 0; i < OVERSAMPLE; i++) {
+			for (int j = 0; j < QUALITY; j++) {
+				kernel[i][QUALITY - 1 - j] = OVERSAMPLE * ir[OVERSAMPLE * j + i];
+			}
+		}
 		reset();
 	}
 	void reset() {
 		inIndex = 0;
-		std::memset(inBuffer, 0, sizeof(inBuffer));
+		std::fill(std::begin(inBuffer), std::end(inBuffer), T(0.f));
 	}
 	/** `out` must be length OVERSAMPLE */
-	void process(float in, float* out) {
-		// Zero-stuff input buffer
-		inBuffer[inIndex] = OVERSAMPLE * in;
+	void process(T in, T* out) {
+		// Push input to both halves of buffer
+		inBuffer[inIndex] = in;
+		inBuffer[inIndex + QUALITY] = in;
 		// Advance index
 		inIndex++;
-		inIndex %= QUALITY;
-		// Naively convolve each sample
-		// TODO replace with polyphase filter hierarchy
+		if (inIndex >= QUALITY)
+			inIndex = 0;
+		// The last QUALITY samples from oldest to newest
+		const T* x = &inBuffer[inIndex];
+		// Convolve each phase
 		for (int i = 0; i < OVERSAMPLE; i++) {
-			float y = 0.f;
-			for (int j = 0; j < QUALITY; j++) {
-				int index = inIndex - 1 - j;
-				index = (index + QUALITY) % QUALITY;
-				int kernelIndex = OVERSAMPLE * j + i;
-				y += kernel[kernelIndex] * inBuffer[index];
+			out[i] = PolyphaseDot<QUALITY, T>::process(kernel[i], x);
+		}
+	}
+};
+
+
+/** Design parameters of a HalfBandUpsampler or HalfBandDecimator cascade.
+*/
+struct HalfBandSpec {
+	/** Proportion of the base Nyquist frequency that must be preserved, from 0 to 1 exclusive. */
+	float passband;
+	/** Minimum stopband attenuation in dB */
+	float attenuation;
+
+	/** Cheapest preset, for modulation sources and control signals */
+	static HalfBandSpec low() {
+		return {0.8f, 60.f};
+	}
+	/** Good for most audio-rate nonlinearities */
+	static HalfBandSpec medium() {
+		return {0.9f, 90.f};
+	}
+	/** Transparent, at roughly three times the cost of medium() */
+	static HalfBandSpec high() {
+		return {0.95f, 120.f};
+	}
+};
+
+
+/** A single 2x stage of a half-band FIR cascade.
+Half-band filters have every even tap zero except the center tap of 1/2, so only the 2*K odd taps are stored.
+Since they are symmetric, each output needs just K multiplications.
+*/
+template <typename T = float>
+struct HalfBandStage {
+	int K = 0;
+	/** The first K odd taps, from the outermost tap toward the center */
+	std::vector<float> coeffs;
+	/** Histories of length 2*K, stored twice so they are always contiguous */
+	std::vector<T> oddBuffer;
+	std::vector<T> evenBuffer;
+	int index = 0;
+
+	/** `transition` is the transition bandwidth normalized to the stage's higher sample rate, from 0 to 0.5. */
+	void design(float transition, float attenuation) {
+		// Kaiser's formulas fall 1 to 2 dB short for half-band filters, so choose the window for some extra attenuation.
+		float a = attenuation + 2.f;
+		float beta;
+		if (a > 50.f)
+			beta = 0.1102f * (a - 8.7f);
+		else if (a > 21.f)
+			beta = 0.5842f * std::pow(a - 21.f, 0.4f) + 0.07886f * (a - 21.f);
+		else
+			beta = 0.f;
+		// Kaiser's estimate of filter order
+		float n = std::ceil((a - 7.95f) / (14.36f * transition)) + 1;
+		K = std::max((int) std::ceil((n + 1) / 4), 1);
+		// The estimate is loose for short filters, so lengthen the filter until it meets the attenuation.
+		// The length is deliberately not capped. The high() preset's first stage needs K = 80.
+		while (true) {
+			designTaps(beta);
+			if (K >= 1024 || getStopbandAttenuation(transition) >= attenuation)
+				break;
+			K++;
+		}
+
+		oddBuffer.assign(4 * K, T(0.f));
+		evenBuffer.assign(4 * K, T(0.f));
+		index = 0;
+	}
+
+	void designTaps(float beta) {
+		int len = 4 * K - 1;
+		coeffs.resize(K);
+		for (int j = 0; j < K; j++) {
+			// Offset of tap from center
+			int t = 2 * j - 2 * K + 1;
+			coeffs[j] = 0.5f * sinc(0.5f * t) * kaiser(beta, float(t + (len - 1) / 2) / (len - 1));
+		}
+		// Normalize DC gain to 1, given the center tap of 1/2
+		float sum = 0.f;
+		for (int j = 0; j < K; j++)
+			sum += 2 * coeffs[j];
+		for (int j = 0; j < K; j++)
+			coeffs[j] *= 0.5f / sum;
+	}
+
+	/** Returns the lowest attenuation in dB from the stopband edge to Nyquist. */
+	float getStopbandAttenuation(float transition) const {
+		double stopEdge = 0.25 + 0.5 * transition;
+		// Several points per sidelobe
+		int points = 16 * (4 * K - 1);
+		double maxGain = 0.0;
+		for (int i = 0; i <= points; i++) {
+			double f = stopEdge + (0.5 - stopEdge) * i / points;
+			double gain = 0.5;
+			for (int j = 0; j < K; j++) {
+				int t = 2 * j - 2 * K + 1;
+				gain += 2 * coeffs[j] * std::cos(2 * M_PI * f * t);
 			}
-			out[i] = y;
+			maxGain = std::fmax(maxGain, std::fabs(gain));
+		}
+		return -20 * std::log10(maxGain);
+	}
+
+	void reset() {
+		std::fill(oddBuffer.begin(), oddBuffer.end(), T(0.f));
+		std::fill(evenBuffer.begin(), evenBuffer.end(), T(0.f));
+		index = 0;
+	}
+
+	/** Returns the odd-tap convolution of a history window of length 2*K, ordered from oldest to newest. */
+	T convolve(const T* x) const {
+		T y = 0.f;
+		for (int j = 0; j < K; j++) {
+			y += coeffs[j] * (x[j] + x[2 * K - 1 - j]);
+		}
+		return y;
+	}
+
+	/** Upsamples one sample to two.
+	Latency is K samples at the lower rate.
+	*/
+	void upsample(T in, T* out) {
+		const T* x = push(oddBuffer, in);
+		out[0] = x[K - 1];
+		out[1] = 2.f * convolve(x);
+		advance();
+	}
+
+	/** Decimates two samples to one.
+	Latency is 2*K - 2 samples at the higher rate.
+	*/
+	T decimate(const T* in) {
+		const T* e = push(evenBuffer, in[0]);
+		const T* o = push(oddBuffer, in[1]);
+		advance();
+		return 0.5f * e[K] + convolve(o);
+	}
+
+	const T* push(std::vector<T>& buffer, T x) {
+		int len = 2 * K;
+		buffer[index] = x;
+		buffer[index + len] = x;
+		return &buffer[index + 1];
+	}
+
+	void advance() {
+		if (++index >= 2 * K)
+			index = 0;
+	}
+};
+
+
+/** Upsamples by a power of 2 with a cascade of half-band FIR stages.
+Each stage doubles the sample rate, and stages at higher rates use wider transition bands, so 8x and 16x cost far less than a single-stage Upsampler.
+T can be `float` or a SIMD type like `simd::float_4`.
+*/
+template <typename T = float>
+struct HalfBandUpsampler {
+	std::vector<HalfBandStage<T>> stages;
+	std::vector<T> tmp;
+
+	/** `factor` must be a power of 2 from 2 to 64. */
+	HalfBandUpsampler(int factor = 2, HalfBandSpec spec = HalfBandSpec::medium()) {
+		setFactor(factor, spec);
+	}
+
+	void setFactor(int factor, HalfBandSpec spec = HalfBandSpec::medium()) {
+		assert(2 <= factor && factor <= 64 && (factor & (factor - 1)) == 0);
+		int numStages = 0;
+		while ((1 << numStages) < factor)
+			numStages++;
+		stages.resize(numStages);
+		for (int i = 0; i < numStages; i++) {
+			// The passband edge, normalized to this stage's output rate
+			float edge = spec.passband / (1 << (i + 2));
+			stages[i].design(0.5f - 2 * edge, spec.attenuation);
+		}
+		tmp.resize(factor);
+	}
+
+	int getFactor() const {
+		return 1 << stages.size();
+	}
+
+	void reset() {
+		for (HalfBandStage<T>& stage : stages)
+			stage.reset();
+	}
+
+	/** `out` must be length getFactor() */
+	void process(T in, T* out) {
+		// Alternate between `out` and `tmp` so the last stage writes to `out`
+		T* src = (stages.size() % 2 == 0) ? out : tmp.data();
+		T* dst = (stages.size() % 2 == 0) ? tmp.data() : out;
+		src[0] = in;
+		int n = 1;
+		for (HalfBandStage<T>& stage : stages) {
+			for (int i = 0; i < n; i++) {
+				stage.upsample(src[i], &dst[2 * i]);
+			}
+			n *= 2;
+			std::swap(src, dst);
+		}
+	}
+
+	/** Returns the group delay in samples at the base rate. */
+	float getLatency() const {
+		float latency = 0.f;
+		for (size_t i = 0; i < stages.size(); i++) {
+			latency += float(stages[i].K) / (1 << i);
+		}
+		return latency;
+	}
+};
+
+
+/** Decimates by a power of 2 with a cascade of half-band FIR stages.
+The counterpart of HalfBandUpsampler.
+*/
+template <typename T = float>
+struct HalfBandDecimator {
+	/** Ordered from the highest rate to the base rate */
+	std::vector<HalfBandStage<T>> stages;
+	std::vector<T> tmp;
+
+	/** `factor` must be a power of 2 from 2 to 64. */
+	HalfBandDecimator(int factor = 2, HalfBandSpec spec = HalfBandSpec::medium()) {
+		setFactor(factor, spec);
+	}
+
+	void setFactor(int factor, HalfBandSpec spec = HalfBandSpec::medium()) {
+		assert(2 <= factor && factor <= 64 && (factor & (factor - 1)) == 0);
+		int numStages = 0;
+		while ((1 << numStages) < factor)
+			numStages++;
+		stages.resize(numStages);
+		for (int i = 0; i < numStages; i++) {
+			// Stage i decimates from rate `factor / 2^i` to `factor / 2^(i+1)`
+			int s = numStages - 1 - i;
+			float edge = spec.passband / (1 << (s + 2));
+			stages[i].design(0.5f - 2 * edge, spec.attenuation);
+		}
+		tmp.resize(factor / 2);
+	}
+
+	int getFactor() const {
+		return 1 << stages.size();
+	}
+
+	void reset() {
+		for (HalfBandStage<T>& stage : stages)
+			stage.reset();
+	}
+
+	/** `in` must be length getFactor() */
+	T process(const T* in) {
+		int n = getFactor() / 2;
+		const T* src = in;
+		for (HalfBandStage<T>& stage : stages) {
+			// In-place is safe since each output only depends on inputs at or before it
+			for (int i = 0; i < n; i++) {
+				tmp[i] = stage.decimate(&src[2 * i]);
+			}
+			src = tmp.data();
+			n /= 2;
+		}
+		return src[0];
+	}
+
+	/** Returns the group delay in samples at the base rate. */
+	float getLatency() const {
+		float latency = 0.f;
+		int numStages = stages.size();
+		for (int i = 0; i < numStages; i++) {
+			// Stage i runs at input rate 2^(numStages - i) times the base rate
+			latency += float(2 * stages[i].K - 2) / (1 << (numStages - i));
 		}
+		return latency;
 	}
 };
 
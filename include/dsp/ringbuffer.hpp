@@ -8,70 +8,142 @@ namespace rack {
 namespace dsp {
 
 
+/** Distance between fields written by different threads, to avoid false sharing.
+Cache lines are 64 bytes on x64 and 128 bytes on Apple ARM64, and adjacent-line prefetching on x64 pairs 64-byte lines.
+Padding is used rather than alignas(), since objects allocated with `new` are not over-aligned before C++17.
+*/
+static const size_t RINGBUFFER_PADDING = 128;
+
+
 /** Lock-free queue with fixed size and no allocations.
 If S is not a power of 2, performance might be reduced, and the index could overflow in a thousand years, but it should usually be fine for your purposes.
 
 Supports only a single producer and consumer.
 To my knowledge, nobody has invented a 100% correct multiple producer/consumer lock-free ring buffer for x86_64.
+
+The producer's and consumer's indices are on separate cache lines, and each side caches the other's index, so the cache line is only transferred when the cached index runs out.
+Producer methods: push(), pushBuffer(), endData(), endIncr()
+Consumer methods: shift(), shiftBuffer(), startData(), startIncr(), clear()
+Either thread: empty(), full(), size(), capacity()
 */
 template <typename T, size_t S>
 struct RingBuffer {
+	/** Written by the consumer */
 	std::atomic<size_t> start{0};
+	/** Consumer's copy of `end` */
+	size_t endCache = 0;
+	char padding1[RINGBUFFER_PADDING];
+	/** Written by the producer */
 	std::atomic<size_t> end{0};
+	/** Producer's copy of `start` */
+	size_t startCache = 0;
+	char padding2[RINGBUFFER_PADDING];
 	T data[S];
 
 	/** Adds an element to the end of the buffer.
+	The buffer must not be full.
 	*/
 	void push(T t) {
-		size_t i = end % S;
-		data[i] = t;
-		end++;
+		size_t e = end.load(std::memory_order_relaxed);
+		data[e % S] = t;
+		end.store(e + 1, std::memory_order_release);
 	}
 	/** Copies an array to the end of the buffer.
-	`n` must be at most S.
+	`n` must be at most capacity().
 	*/
 	void pushBuffer(const T* t, int n) {
-		size_t i = end % S;
+		size_t e = end.load(std::memory_order_relaxed);
+		size_t i = e % S;
 		size_t e1 = i + n;
 		size_t e2 = (e1 < S) ? e1 : S;
 		std::memcpy(&data[i], t, sizeof(T) * (e2 - i));
 		if (e1 > S) {
 			std::memcpy(data, &t[S - i], sizeof(T) * (e1 - S));
 		}
-		end += n;
+		end.store(e + n, std::memory_order_release);
 	}
 	/** Removes and returns an element from the start of the buffer.
+	The buffer must not be empty.
 	*/
 	T shift() {
-		size_t i = start % S;
-		T t = data[i];
-		start++;
+		size_t s = start.load(std::memory_order_relaxed);
+		T t = data[s % S];
+		start.store(s + 1, std::memory_order_release);
 		return t;
 	}
 	/** Removes and copies an array from the start of the buffer.
-	`n` must be at most S.
+	`n` must be at most size().
 	*/
 	void shiftBuffer(T* t, size_t n) {
-		size_t i = start % S;
+		size_t s = start.load(std::memory_order_relaxed);
+		size_t i = s % S;
 		size_t s1 = i + n;
 		size_t s2 = (s1 < S) ? s1 : S;
 		std::memcpy(t, &data[i], sizeof(T) * (s2 - i));
 		if (s1 > S) {
 			std::memcpy(&t[S - i], data, sizeof(T) * (s1 - S));
 		}
-		start += n;
+		start.store(s + n, std::memory_order_release);
 	}
+
+	/** Returns a pointer to contiguous free elements at the end of the buffer, and sets `n` to their number.
+	This can be less than capacity() if the free space wraps around the end of the array.
+	Write up to `n` elements and commit them with endIncr(), which makes them visible to the consumer in a batch.
+	*/
+	T* endData(size_t* n) {
+		size_t e = end.load(std::memory_order_relaxed);
+		size_t i = e % S;
+		size_t contiguous = S - i;
+		// push() and pushBuffer() don't update startCache, so it can be more than S behind `e`.
+		size_t used = e - startCache;
+		size_t free = (used < S) ? S - used : 0;
+		// Only reload the consumer's index if it might give more space
+		if (free < contiguous) {
+			startCache = start.load(std::memory_order_acquire);
+			free = S - (e - startCache);
+		}
+		*n = std::min(free, contiguous);
+		return &data[i];
+	}
+	void endIncr(size_t n) {
+		end.store(end.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+	/** Returns a pointer to contiguous elements at the start of the buffer, and sets `n` to their number.
+	This can be less than size() if the elements wrap around the end of the array.
+	Read up to `n` elements and release them with startIncr().
+	*/
+	const T* startData(size_t* n) {
+		size_t s = start.load(std::memory_order_relaxed);
+		size_t i = s % S;
+		size_t contiguous = S - i;
+		// shift(), shiftBuffer(), and clear() don't update endCache, so it can be behind `s`.
+		size_t available = (endCache > s) ? endCache - s : 0;
+		// Only reload the producer's index if it might give more elements
+		if (available < contiguous) {
+			endCache = end.load(std::memory_order_acquire);
+			available = endCache - s;
+		}
+		*n = std::min(available, contiguous);
+		return &data[i];
+	}
+	void startIncr(size_t n) {
+		start.store(start.load(std::memory_order_relaxed) + n, std::memory_order_release);
+	}
+
 	void clear() {
-		start = end.load();
+		start.store(end.load(std::memory_order_acquire), std::memory_order_release);
 	}
 	bool empty() const {
-		return start >= end;
+		return size() == 0;
 	}
 	bool full() const {
-		return end - start >= S;
+		return size() >= S;
 	}
 	size_t size() const {
-		return end - start;
+		// Load start first, so end is at least as new and the difference is not negative
+		size_t s = start.load(std::memory_order_acquire);
+		size_t e = end.load(std::memory_order_acquire);
+		return e - s;
 	}
 	size_t capacity() const {
 		return S - size();
@@ -79,37 +151,42 @@ struct RingBuffer {
 };
 
 /** A cyclic buffer which maintains a valid linear array of size S by keeping a copy of the buffer in adjacent memory.
-This is not thread-safe.
+Supports a single producer and consumer, like RingBuffer.
 */
 template <typename T, size_t S>
 struct DoubleRingBuffer {
 	std::atomic<size_t> start{0};
+	char padding1[RINGBUFFER_PADDING];
 	std::atomic<size_t> end{0};
+	char padding2[RINGBUFFER_PADDING];
 	T data[2 * S];
 
 	void push(T t) {
-		size_t i = end % S;
+		size_t e = end.load(std::memory_order_relaxed);
+		size_t i = e % S;
 		data[i] = t;
 		data[i + S] = t;
-		end++;
+		end.store(e + 1, std::memory_order_release);
 	}
 	T shift() {
-		size_t i = start % S;
-		T t = data[i];
-		start++;
+		size_t s = start.load(std::memory_order_relaxed);
+		T t = data[s % S];
+		start.store(s + 1, std::memory_order_release);
 		return t;
 	}
 	void clear() {
-		start = end.load();
+		start.store(end.load(std::memory_order_acquire), std::memory_order_release);
 	}
 	bool empty() const {
-		return start >= end;
+		return size() == 0;
 	}
 	bool full() const {
-		return end - start >= S;
+		return size() >= S;
 	}
 	size_t size() const {
-		return end - start;
+		size_t s = start.load(std::memory_order_acquire);
+		size_t e = end.load(std::memory_order_acquire);
+		return e - s;
 	}
 	size_t capacity() const {
 		return S - size();
@@ -119,11 +196,12 @@ struct DoubleRingBuffer {
 	Pointer is invalidated when any other method is called.
 	*/
 	T* endData() {
-		size_t i = end % S;
+		size_t i = end.load(std::memory_order_relaxed) % S;
 		return &data[i];
 	}
 	void endIncr(size_t n) {
-		size_t i = end % S;
+		size_t e = end.load(std::memory_order_relaxed);
+		size_t i = e % S;
 		size_t e1 = i + n;
 		size_t e2 = (e1 < S) ? e1 : S;
 		// Copy data forward
@@ -133,17 +211,17 @@ struct DoubleRingBuffer {
 			// Copy data backward from the doubled block to the main block
 			std::memcpy(data, &data[S], sizeof(T) * (e1 - S));
 		}
-		end += n;
+		end.store(e + n, std::memory_order_release);
 	}
 	/** Returns a pointer to S consecutive elements for consumption
 	If any data is consumed, call startIncr afterwards.
 	*/
 	const T* startData() const {
-		size_t i = start % S;
+		size_t i = start.load(std::memory_order_relaxed) % S;
 		return &data[i];
 	}
 	void startIncr(size_t n) {
-		start += n;
+		start.store(start.load(std::memory_order_relaxed) + n, std::memory_order_release);
 	}
 };
 
@@ -216,5 +294,86 @@ struct AppleRingBuffer {
 };
 
 
+/** Lock-free channel for passing snapshots of `T` from a single producer to a single consumer, keeping only the latest.
+Useful for sending scope, spectrum, or meter data from Module::process() to ModuleWidget::step().
+Neither side ever blocks or sees a partially written snapshot, and the producer never waits for the consumer.
+
+There are three buffers: one being written, one being read, and the latest published one in between.
+publish() swaps the written buffer with the middle one, and update() swaps the middle one with the read buffer if it is newer.
+
+Example:
+
+	struct ScopeData {
+		float samples[512];
+	};
+
+	// In the Module
+	dsp::TripleBuffer<ScopeData> scopeBuffer;
+
+	// In process(), once per block
+	scopeBuffer.write() = ...;
+	scopeBuffer.publish();
+
+	// In the ModuleWidget's step() or draw()
+	if (module->scopeBuffer.update()) {
+		const ScopeData& data = module->scopeBuffer.read();
+	}
+*/
+template <typename T>
+struct TripleBuffer {
+	/** Set in `middle` when it holds a snapshot the consumer hasn't taken */
+	static const int FRESH = 4;
+
+	/** Index of the latest published buffer, or'd with FRESH */
+	std::atomic<int> middle{1};
+	char padding1[RINGBUFFER_PADDING];
+	/** Only accessed by the producer */
+	int writeIndex = 0;
+	char padding2[RINGBUFFER_PADDING];
+	/** Only accessed by the consumer */
+	int readIndex = 2;
+	char padding3[RINGBUFFER_PADDING];
+	T buffers[3] = {};
+
+	/** Returns the buffer to fill with the next snapshot.
+	It contains an old snapshot, so either overwrite all of it or write it fully each time.
+	Producer only.
+	*/
+	T& write() {
+		return buffers[writeIndex];
+	}
+	/** Makes the written buffer the latest snapshot.
+	Producer only.
+	*/
+	void publish() {
+		writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & ~FRESH;
+	}
+	/** Copies `t` as the latest snapshot.
+	Producer only.
+	*/
+	void push(const T& t) {
+		write() = t;
+		publish();
+	}
+
+	/** Takes the latest snapshot if one was published since the last call.
+	Returns whether read() changed.
+	Consumer only.
+	*/
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & FRESH))
+			return false;
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & ~FRESH;
+		return true;
+	}
+	/** Returns the snapshot taken by the last update(), which stays valid and unchanged until the next update().
+	Consumer only.
+	*/
+	const T& read() const {
+		return buffers[readIndex];
+	}
+};
+
+
 } // namespace dsp
 } // namespace rack
@@ -0,0 +1,68 @@
+#pragma once
+#include <functional>
+
+#include <dsp/common.hpp>
+#include <dsp/fft.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/** Streaming short-time Fourier transform with overlap-add resynthesis.
+
+Every `hopSize` frames, the last `fftSize` input frames are windowed and transformed, passed to the spectrum processor, transformed back, windowed again, and overlap-added to the output.
+The output is normalized by the overlapping squared windows, so the signal is reconstructed exactly if the processor leaves the spectrum unchanged, for any window whose overlapping squares are nonzero.
+
+If `async` is true, the transforms and processor run on a helper thread, and each frame has `hopSize` frames of time to finish.
+The audio thread hands frames to the helper thread through atomics and a semaphore without locking, and waits only if a frame is late.
+
+setWindow(), setProcessor(), and reset() must not be called concurrently with processBlock(), since they read and finish the frames the audio thread has in flight.
+Call them from the thread that calls processBlock(), such as in Module::process(), or from an event the engine sends between blocks, such as Module::onSampleRateChange().
+*/
+struct Stft {
+	struct Internal;
+	Internal* internal;
+
+	/** Modifies a spectrum of `fftSize` elements in place, in the order returned by RealFFT::rfft().
+	Called on the helper thread if async.
+	*/
+	typedef std::function<void(float* spectrum)> Processor;
+
+	/** `fftSize` must be a multiple of 32, and `hopSize` must divide `fftSize`. */
+	Stft(int fftSize, int hopSize, bool async = false);
+	~Stft();
+
+	/** Sets the analysis and synthesis window of length `fftSize`.
+	Defaults to a periodic Hann window.
+	Not real-time safe, and must not be called concurrently with processBlock().
+	*/
+	void setWindow(const float* window);
+	/** Not real-time safe, and must not be called concurrently with processBlock().
+	Stops the helper thread while the processor is replaced.
+	*/
+	void setProcessor(Processor processor);
+	/** Clears the input and output history, and discards the output of the frame in flight.
+	Must not be called concurrently with processBlock().
+	*/
+	void reset();
+
+	/** Processes `frames` frames of any length. */
+	void processBlock(const float* input, float* output, int frames);
+	float process(float in) {
+		float out;
+		processBlock(&in, &out, 1);
+		return out;
+	}
+
+	int getFftSize();
+	int getHopSize();
+	/** Returns the delay from input to output in frames: `fftSize`, plus `hopSize` if async. */
+	int getLatency();
+	/** Returns the number of times the audio thread had to wait for the helper thread. */
+	uint64_t getLateCount();
+};
+
+
+} // namespace dsp
+} // namespace rack
@@ -1,5 +1,7 @@
 #pragma once
 #include <dsp/common.hpp>
+#include <dsp/filter.hpp>
+#include <dsp/window.hpp>
 
 
 namespace rack {
@@ -45,15 +47,17 @@ for (int i = 0; i < 6; i++) {
 	lights[i].setBrightness(b);
 }
 ```
+Use `TVuMeter2<simd::float_4>` to meter 4 channels at once.
 */
-struct VuMeter2 {
+template <typename T = float>
+struct TVuMeter2 {
 	enum Mode {
 		PEAK,
 		RMS
 	};
 	Mode mode = PEAK;
 	/** Either the smoothed peak or the mean-square of the brightness, depending on the mode. */
-	float v = 0.f;
+	T v = 0.f;
 	/** Inverse time constant in 1/seconds */
 	float lambda = 30.f;
 
@@ -61,19 +65,39 @@ struct VuMeter2 {
 		v = 0.f;
 	}
 
-	void process(float deltaTime, float value) {
+	void process(float deltaTime, T value) {
 		if (mode == RMS) {
-			value = std::pow(value, 2);
+			value = value * value;
 			v += (value - v) * lambda * deltaTime;
 		}
 		else {
-			value = std::fabs(value);
-			if (value >= v) {
-				v = value;
+			value = simd::fabs(value);
+			// Jumps up to the value, or decays towards it
+			v = simd::fmax(value, v + (value - v) * lambda * deltaTime);
+		}
+	}
+
+	/** Processes `frames` values at once, where `deltaTime` is the time between values.
+	Equivalent to calling process() for each value, except that peaks and mean-squares are combined within the block before smoothing.
+	*/
+	void processBlock(float deltaTime, const T* values, int frames) {
+		if (frames <= 0)
+			return;
+		float k = 1.f - std::exp(-lambda * deltaTime * frames);
+		if (mode == RMS) {
+			T sum = 0.f;
+			for (int i = 0; i < frames; i++) {
+				sum += values[i] * values[i];
 			}
-			else {
-				v += (value - v) * lambda * deltaTime;
+			T value = sum / frames;
+			v += (value - v) * k;
+		}
+		else {
+			T value = 0.f;
+			for (int i = 0; i < frames; i++) {
+				value = simd::fmax(value, simd::fabs(values[i]));
 			}
+			v = simd::fmax(value, v + (value - v) * k);
 		}
 	}
 
@@ -82,14 +106,288 @@ struct VuMeter2 {
 	Set dbMin == dbMax == 0.f for a clip indicator that turns fully on when db >= dbMax.
 	Expensive, so call this infrequently.
 	*/
-	float getBrightness(float dbMin, float dbMax) {
-		float db = amplitudeToDb((mode == RMS) ? std::sqrt(v) : v);
-		if (db >= dbMax)
-			return 1.f;
-		else if (db <= dbMin)
-			return 0.f;
-		else
-			return math::rescale(db, dbMin, dbMax, 0.f, 1.f);
+	T getBrightness(float dbMin, float dbMax) {
+		T db = amplitudeToDb((mode == RMS) ? simd::sqrt(v) : v);
+		T b = simd::rescale(db, dbMin, dbMax, 0.f, 1.f);
+		b = simd::ifelse(db <= dbMin, 0.f, b);
+		return simd::ifelse(db >= dbMax, 1.f, b);
+	}
+};
+
+typedef TVuMeter2<> VuMeter2;
+
+
+/** Meters up to 16 channels in blocks, such as all channels of a polyphonic port.
+Channels are processed 4 at a time with SIMD, and levels are smoothed once per chunk of frames rather than per frame.
+
+Measures
+- RMS, smoothed with the time constant `1 / rmsLambda`
+- peak, with instant attack and release time constant `1 / peakLambda`
+- true-peak, the peak of the signal upsampled 4x, as in ITU-R BS.1770-4 Annex 2
+- momentary (400 ms) and short-term (3 s) loudness in LUFS of all channels, K-weighted and summed with equal weights
+
+True-peak and loudness are more expensive, so they are disabled by default.
+Values are relative to a full scale of 1, so scale Rack voltages by 1/10 V, like the Audio module.
+*/
+struct LevelMeter {
+	typedef simd::float_4 T;
+
+	static const int GROUPS = 4;
+	/** Frames processed at once between smoothing updates */
+	static const int CHUNK = 32;
+	/** Taps of each phase of the true-peak interpolation filter */
+	static const int TAPS = 12;
+	static const int PHASES = 4;
+	/** Loudness is measured in sub-blocks of 100 ms */
+	static const int SUBBLOCKS = 30;
+	static const int MOMENTARY_SUBBLOCKS = 4;
+
+	float rmsLambda = 1 / 0.3f;
+	float peakLambda = 1 / 1.7f;
+	bool truePeakEnabled = false;
+	bool loudnessEnabled = false;
+
+	float sampleTime = 1 / 44100.f;
+	T meanSquare[GROUPS];
+	T peak[GROUPS];
+	T truePeak[GROUPS];
+
+	/** Interpolation filter for each phase */
+	float truePeakTaps[PHASES][TAPS];
+	/** Last TAPS inputs of each group, stored twice so they can be read contiguously */
+	T truePeakHistory[GROUPS][2 * TAPS];
+	int truePeakPos = 0;
+
+	/** Shelf and highpass of the K-weighting filter */
+	TBiquadCascade<2, T> kFilter[GROUPS];
+	/** Sum of squares of the K-weighted signal of all channels in the current sub-block */
+	double subBlockEnergy = 0.0;
+	int subBlockPos = 0;
+	int subBlockLength = 4410;
+	/** Mean-square of the last sub-blocks, summed over channels */
+	float subBlockPowers[SUBBLOCKS];
+	int subBlockIndex = 0;
+	float momentaryPower = 0.f;
+	float shortTermPower = 0.f;
+
+	LevelMeter() {
+		// Windowed sinc interpolator, with each phase normalized to unity DC gain
+		for (int p = 0; p < PHASES; p++) {
+			float sum = 0.f;
+			for (int k = 0; k < TAPS; k++) {
+				int n = k * PHASES + p;
+				float t = n - (TAPS * PHASES - 1) / 2.f;
+				float h = sinc(t / PHASES) * blackmanHarris((n + 0.5f) / (TAPS * PHASES));
+				truePeakTaps[p][k] = h;
+				sum += h;
+			}
+			for (int k = 0; k < TAPS; k++) {
+				truePeakTaps[p][k] /= sum;
+			}
+		}
+		setSampleRate(44100.f);
+		reset();
+	}
+
+	void reset() {
+		for (int g = 0; g < GROUPS; g++) {
+			meanSquare[g] = 0.f;
+			peak[g] = 0.f;
+			truePeak[g] = 0.f;
+			for (int k = 0; k < 2 * TAPS; k++) {
+				truePeakHistory[g][k] = 0.f;
+			}
+			kFilter[g].reset();
+		}
+		subBlockEnergy = 0.0;
+		subBlockPos = 0;
+		for (int i = 0; i < SUBBLOCKS; i++) {
+			subBlockPowers[i] = 0.f;
+		}
+		subBlockIndex = 0;
+		momentaryPower = 0.f;
+		shortTermPower = 0.f;
+	}
+
+	/** Sets the sample rate and recomputes the K-weighting filter.
+	Uses the sample-rate-independent K-weighting design of libebur128.
+	*/
+	void setSampleRate(float sampleRate) {
+		sampleTime = 1.f / sampleRate;
+		subBlockLength = std::max((int) std::round(sampleRate * 0.1f), 1);
+
+		double fs = sampleRate;
+		// High shelf, +4 dB above about 1.5 kHz
+		double f0 = 1681.974450955533;
+		double G = 3.999843853973347;
+		double Q = 0.7071752369554196;
+		double K = std::tan(M_PI * f0 / fs);
+		double Vh = std::pow(10.0, G / 20.0);
+		double Vb = std::pow(Vh, 0.4996667741545416);
+		double a0 = 1.0 + K / Q + K * K;
+		T shelfB[3] = {
+			float((Vh + Vb * K / Q + K * K) / a0),
+			float(2.0 * (K * K - Vh) / a0),
+			float((Vh - Vb * K / Q + K * K) / a0),
+		};
+		T shelfA[2] = {
+			float(2.0 * (K * K - 1.0) / a0),
+			float((1.0 - K / Q + K * K) / a0),
+		};
+		// Highpass at 38 Hz
+		f0 = 38.13547087602444;
+		Q = 0.5003270373238773;
+		K = std::tan(M_PI * f0 / fs);
+		a0 = 1.0 + K / Q + K * K;
+		T highpassB[3] = {1.f, -2.f, 1.f};
+		T highpassA[2] = {
+			float(2.0 * (K * K - 1.0) / a0),
+			float((1.0 - K / Q + K * K) / a0),
+		};
+		for (int g = 0; g < GROUPS; g++) {
+			kFilter[g].setCoefficients(0, shelfB, shelfA);
+			kFilter[g].setCoefficients(1, highpassB, highpassA);
+			kFilter[g].snap();
+		}
+	}
+
+	/** Processes `frames` frames of `channels` channels, where channel `c` of frame `i` is `in[i * stride + c]`.
+	*/
+	void processBlock(const float* in, int stride, int channels, int frames) {
+		int groups = std::min((channels + 3) / 4, (int) GROUPS);
+		while (frames > 0) {
+			int n = std::min(frames, (int) CHUNK);
+			// Don't cross the end of a loudness sub-block
+			if (loudnessEnabled)
+				n = std::min(n, subBlockLength - subBlockPos);
+
+			for (int g = 0; g < groups; g++) {
+				T x[CHUNK];
+				int c = 4 * g;
+				if (c + 4 <= channels) {
+					for (int i = 0; i < n; i++) {
+						x[i] = T::load(&in[i * stride + c]);
+					}
+				}
+				else {
+					// Don't read past the last channel, and zero unused lanes
+					for (int i = 0; i < n; i++) {
+						x[i] = 0.f;
+						for (int j = 0; c + j < channels; j++) {
+							x[i].s[j] = in[i * stride + c + j];
+						}
+					}
+				}
+				processChunk(g, x, n);
+			}
+			if (truePeakEnabled)
+				truePeakPos = (truePeakPos + (TAPS - n % TAPS)) % TAPS;
+			if (loudnessEnabled) {
+				subBlockPos += n;
+				if (subBlockPos >= subBlockLength)
+					endSubBlock();
+			}
+
+			in += n * stride;
+			frames -= n;
+		}
+		// Channels above `channels` are silent
+		for (int g = groups; g < GROUPS; g++) {
+			meanSquare[g] = 0.f;
+			peak[g] = 0.f;
+			truePeak[g] = 0.f;
+		}
+	}
+
+	/** Processes one frame, such as a Port's voltages. */
+	void process(const float* in, int channels) {
+		processBlock(in, 0, channels, 1);
+	}
+
+	float getRms(int c) {
+		return std::sqrt(meanSquare[c / 4][c % 4]);
+	}
+	float getPeak(int c) {
+		return peak[c / 4][c % 4];
+	}
+	/** Returns 0 unless `truePeakEnabled` is set. */
+	float getTruePeak(int c) {
+		return truePeak[c / 4][c % 4];
+	}
+	/** Returns the loudness of the last 400 ms in LUFS, or -inf if silent. Requires `loudnessEnabled`. */
+	float getMomentaryLoudness() {
+		return -0.691f + 10.f * std::log10(momentaryPower);
+	}
+	/** Returns the loudness of the last 3 s in LUFS, or -inf if silent. Requires `loudnessEnabled`. */
+	float getShortTermLoudness() {
+		return -0.691f + 10.f * std::log10(shortTermPower);
+	}
+
+private:
+	void processChunk(int g, const T* x, int n) {
+		float dt = sampleTime * n;
+
+		// RMS
+		T sum = 0.f;
+		T chunkPeak = 0.f;
+		for (int i = 0; i < n; i++) {
+			sum += x[i] * x[i];
+			chunkPeak = simd::fmax(chunkPeak, simd::fabs(x[i]));
+		}
+		float rmsK = 1.f - std::exp(-rmsLambda * dt);
+		meanSquare[g] += (sum / n - meanSquare[g]) * rmsK;
+
+		// Peak
+		float peakK = 1.f - std::exp(-peakLambda * dt);
+		peak[g] = simd::fmax(chunkPeak, peak[g] + (chunkPeak - peak[g]) * peakK);
+
+		// True-peak
+		if (truePeakEnabled) {
+			T chunkTruePeak = chunkPeak;
+			T* history = truePeakHistory[g];
+			int pos = truePeakPos;
+			for (int i = 0; i < n; i++) {
+				// Insert backwards so history[pos + k] is the input k frames ago
+				pos = (pos == 0) ? TAPS - 1 : pos - 1;
+				history[pos] = x[i];
+				history[pos + TAPS] = x[i];
+				const T* window = &history[pos];
+				for (int p = 0; p < PHASES; p++) {
+					T y = 0.f;
+					for (int k = 0; k < TAPS; k++) {
+						y += truePeakTaps[p][k] * window[k];
+					}
+					chunkTruePeak = simd::fmax(chunkTruePeak, simd::fabs(y));
+				}
+			}
+			truePeak[g] = simd::fmax(chunkTruePeak, truePeak[g] + (chunkTruePeak - truePeak[g]) * peakK);
+		}
+
+		// Loudness
+		if (loudnessEnabled) {
+			T y[CHUNK];
+			kFilter[g].processBlock(x, y, n);
+			T energy = 0.f;
+			for (int i = 0; i < n; i++) {
+				energy += y[i] * y[i];
+			}
+			subBlockEnergy += energy[0] + energy[1] + energy[2] + energy[3];
+		}
+	}
+
+	void endSubBlock() {
+		subBlockPowers[subBlockIndex] = subBlockEnergy / subBlockPos;
+		subBlockIndex = (subBlockIndex + 1) % SUBBLOCKS;
+		subBlockEnergy = 0.0;
+		subBlockPos = 0;
+
+		float sum = 0.f;
+		for (int i = 1; i <= SUBBLOCKS; i++) {
+			sum += subBlockPowers[(subBlockIndex + SUBBLOCKS - i) % SUBBLOCKS];
+			if (i == MOMENTARY_SUBBLOCKS)
+				momentaryPower = sum / MOMENTARY_SUBBLOCKS;
+		}
+		shortTermPower = sum / SUBBLOCKS;
 	}
 };
 
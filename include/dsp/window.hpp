@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+
 #include <math.hpp>
 #include <simd/Vector.hpp>
 #include <simd/functions.hpp>
@@ -79,6 +81,38 @@ inline void blackmanHarrisWindow(float* x, int len) {
 	}
 }
 
+/** Zeroth-order modified Bessel function of the first kind, used by the Kaiser window.
+https://en.wikipedia.org/wiki/Bessel_function#Modified_Bessel_functions:_I%CE%B1,_K%CE%B1
+*/
+inline float besselI0(float x) {
+	// Power series converges quickly for the arguments used by window functions
+	double sum = 1.0;
+	double term = 1.0;
+	double y = double(x) * x / 4;
+	for (int k = 1; k < 64; k++) {
+		term *= y / (k * k);
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/** Kaiser window function.
+https://en.wikipedia.org/wiki/Kaiser_window
+`beta` trades main lobe width for sidelobe level. 0 is rectangular, and typical values are 4 to 12.
+*/
+inline float kaiser(float beta, float p) {
+	float t = 2 * p - 1;
+	return besselI0(beta * std::sqrt(std::max(1 - t * t, 0.f))) / besselI0(beta);
+}
+
+inline void kaiserWindow(float beta, float* x, int len) {
+	for (int i = 0; i < len; i++) {
+		x[i] *= kaiser(beta, float(i) / (len - 1));
+	}
+}
+
 
 } // namespace dsp
 } // namespace rack
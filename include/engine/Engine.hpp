@@ -181,6 +181,30 @@ struct Engine {
 	Share-locks.
 	*/
 	Cable* getCable(int64_t cableId);
+	/** Takes the latest port summaries published by the engine.
+	The engine publishes a summary of each cable's voltages at the end of each block.
+	Call once per UI frame before getPortSummary().
+	UI thread only. Does not lock.
+	*/
+	void updatePortSummaries();
+	/** Returns the summary of the cable's voltages taken by the last updatePortSummaries(), or NULL if the cable has none yet.
+	The pointer is valid until the next updatePortSummaries().
+	UI thread only. Does not lock.
+	*/
+	const PortSummary* getPortSummary(int64_t cableId);
+
+	// Lights
+	/** Takes the latest snapshot of all module lights, and requests the engine to take another at the end of its next block.
+	Call once per UI frame before getLightSnapshot().
+	UI thread only. Does not lock.
+	*/
+	void updateLightSnapshot();
+	/** Returns the brightnesses of the module's lights in the snapshot taken by the last updateLightSnapshot(), or NULL if the module isn't in it.
+	Sets `lightsLen` to the number of lights in the snapshot.
+	The pointer is valid until the next updateLightSnapshot().
+	UI thread only. Does not lock.
+	*/
+	const float* getLightSnapshot(int64_t moduleId, int* lightsLen);
 
 	// Params
 	void setParamValue(Module* module, int paramId, float value);
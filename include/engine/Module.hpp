@@ -324,6 +324,14 @@ struct Module {
 		float sampleTime;
 		/** Number of audio samples since the Engine's first sample. */
 		int64_t frame;
+		/** Whether the engine copies lights to the UI after this frame.
+		Lights are only displayed at these frames, so modules can skip setting lights on other frames.
+		*/
+		bool lightFrame;
+		/** Time in seconds since the previous light frame.
+		Use as the `deltaTime` of Light::setBrightnessSmooth() on light frames.
+		*/
+		float lightTime;
 	};
 	/** Advances the module by one audio sample.
 	Override this method to read Inputs and Params and to write Outputs and Lights.
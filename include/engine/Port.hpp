@@ -11,6 +11,20 @@ namespace engine {
 static const int PORT_MAX_CHANNELS = 16;
 
 
+/** Statistics of the voltages flowing through a cable over an engine block.
+Both ports of a cable carry the same voltages, so the UI renders plug lights from this instead of reading ports while the engine writes them.
+*/
+struct PortSummary {
+	int64_t cableId = -1;
+	/** Number of polyphonic channels at the end of the block */
+	int channels = 0;
+	/** Mean voltage over time of the first channel */
+	float mean = 0.f;
+	/** Root-mean-square over time of `getVoltageRMS()` */
+	float rms = 0.f;
+};
+
+
 struct Port {
 	/** Voltage of the port. */
 	union {
@@ -29,8 +43,8 @@ struct Port {
 		/** DEPRECATED. Unstable API. Use isConnected() instead. */
 		uint8_t active;
 	};
-	/** For rendering plug lights on cables.
-	Green for positive, red for negative, and blue for polyphonic.
+	/** DEPRECATED. No longer updated by the engine.
+	Plug lights are rendered from the PortSummary published by the engine.
 	*/
 	Light plugLights[3];
 
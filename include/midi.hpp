@@ -179,6 +179,18 @@ struct OutputDevice : Device {
 	void unsubscribe(Output* output);
 	/** Sends a MIDI message to the device. */
 	virtual void sendMessage(const Message& message) {}
+	/** Returns the number of scheduled messages waiting to be sent. */
+	virtual size_t getQueueSize() {
+		return 0;
+	}
+	/** Returns the number of messages rejected because the queue was full. */
+	virtual uint64_t getDroppedCount() {
+		return 0;
+	}
+	/** Returns the number of controller messages superseded by a later one before being sent. */
+	virtual uint64_t getCoalescedCount() {
+		return 0;
+	}
 };
 
 ////////////////////
@@ -285,6 +297,10 @@ struct Output : Port {
 	std::vector<int> getChannels() override;
 
 	void sendMessage(const Message& message);
+	/** Statistics of the output device, or 0 if no device is selected. See OutputDevice. */
+	size_t getQueueSize();
+	uint64_t getDroppedCount();
+	uint64_t getCoalescedCount();
 };
 
 
@@ -0,0 +1,20 @@
+#pragma once
+#include <common.hpp>
+#include <midi.hpp>
+
+
+namespace rack {
+/** MIDI driver which plays Standard MIDI Files into Inputs and records Outputs to Standard MIDI Files.
+
+Input devices are the `.mid` files in the user `midi` directory.
+Output devices are recorders which write `midi/Record N.mid` when the last Output unsubscribes.
+Messages are stamped with Engine frames, so playback and recording are sample-accurate and don't require MIDI hardware.
+*/
+namespace midifile {
+
+
+PRIVATE void init();
+
+
+} // namespace midifile
+} // namespace rack
@@ -111,7 +111,9 @@ Directly including Rack headers other than rack.hpp in your plugin is unsupporte
 #include <dsp/window.hpp>
 #include <dsp/ode.hpp>
 #include <dsp/minblep.hpp>
+#include <dsp/kernels.hpp>
 #include <dsp/fft.hpp>
+#include <dsp/stft.hpp>
 #include <dsp/ringbuffer.hpp>
 #include <dsp/resampler.hpp>
 #include <dsp/fir.hpp>
@@ -3,6 +3,8 @@
 #include <random>
 #include <vector>
 
+#include <simd/Vector.hpp>
+
 
 namespace rack {
 /** Random number generation */
@@ -61,15 +63,65 @@ struct Xoroshiro128Plus {
 };
 
 
+/** Four interleaved xoshiro128+ generators, producing 4 random uint32_t values in a vector per step.
+From https://prng.di.unimi.it/
+Use the upper bits, since the lowest bits of xoshiro128+ have low linear complexity.
+*/
+struct Xoshiro128PlusVector {
+	simd::int32_4 state[4];
+
+	void seed(const uint32_t* s) {
+		for (int i = 0; i < 4; i++) {
+			state[i] = simd::int32_4::load((const int32_t*) &s[4 * i]);
+		}
+	}
+
+	static simd::int32_4 rotl(simd::int32_4 x, int k) {
+		return (x << k) | (x >> (32 - k));
+	}
+
+	simd::int32_4 operator()() {
+		simd::int32_4 result = state[0] + state[3];
+		simd::int32_4 t = state[1] << 9;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 11);
+
+		return result;
+	}
+
+	/** Returns 4 uniform random floats in the interval [0, 1) */
+	simd::float_4 uniform() {
+		// Top 24 bits, which fit exactly in the float mantissa
+		return simd::float_4(operator()() >> 8) * 5.96046448e-08f;
+	}
+};
+
+
 // Simple global API
+/*
+Each thread has its own generators, seeded from a master seed and the order in which threads first use them.
+*/
 
+/** Seeds the master seed from the current time, unless seed() has been called. */
 void init();
 
-/** Returns the generator.
-Named "local" because the generator was thread-local in previous versions.
+/** Sets the master seed, and reseeds the generators of all threads on their next use.
+Threads are assigned streams in the order in which they next call a random function, so renders are reproducible if the same threads make the same calls.
+With multiple engine threads, modules are scheduled to threads dynamically, so use 1 thread for bit-reproducible renders.
 */
+void seed(uint64_t seed);
+
+/** Returns the calling thread's generator. */
 Xoroshiro128Plus& local();
 
+/** Returns the calling thread's vector generator. */
+Xoshiro128PlusVector& localVector();
+
 template <typename T>
 T get() {
 	// Call operator()() and cast by default
@@ -132,6 +184,20 @@ inline float normal() {
 	// return (sum - n / 2.f) / std::sqrt(n / 12.f);
 }
 
+/** Fills an array with uniform random floats in the interval [0, 1), generating 4 at a time. */
+void uniformBuffer(float* out, size_t len);
+
+inline void uniformBuffer(simd::float_4* out, size_t len) {
+	uniformBuffer((float*) out, len * 4);
+}
+
+/** Fills an array with normal random floats with mean 0 and standard deviation 1, generating 8 at a time. */
+void normalBuffer(float* out, size_t len);
+
+inline void normalBuffer(simd::float_4* out, size_t len) {
+	normalBuffer((float*) out, len * 4);
+}
+
 /** Fills an array with random bytes. */
 inline void buffer(uint8_t* out, size_t len) {
 	Xoroshiro128Plus& rng = local();
@@ -333,11 +333,232 @@ inline Vector<int32_t, 4> operator>>(const Vector<int32_t, 4>& a, const int& b)
 }
 
 
+#if defined(__AVX__)
+
+/** Wrapper for `__m256` representing an aligned vector of 8 single-precision float values.
+Requires AVX. Integer operations on 8 elements require AVX2, so there is no `Vector<int32_t, 8>`.
+*/
+template <>
+struct Vector<float, 8> {
+	using type = float;
+	constexpr static int size = 8;
+
+	union {
+		__m256 v;
+		float s[8];
+	};
+
+	Vector() = default;
+	Vector(__m256 v) : v(v) {}
+	Vector(float x) {
+		v = _mm256_set1_ps(x);
+	}
+	Vector(float x1, float x2, float x3, float x4, float x5, float x6, float x7, float x8) {
+		v = _mm256_setr_ps(x1, x2, x3, x4, x5, x6, x7, x8);
+	}
+	/** Constructs a vector from its lower and upper halves. */
+	Vector(Vector<float, 4> lo, Vector<float, 4> hi) {
+		v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+	}
+	static Vector zero() {
+		return Vector(_mm256_setzero_ps());
+	}
+	static Vector mask() {
+		return Vector(_mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+	}
+	static Vector load(const float* x) {
+		return Vector(_mm256_loadu_ps(x));
+	}
+	void store(float* x) {
+		_mm256_storeu_ps(x, v);
+	}
+	Vector<float, 4> lo() const {
+		return Vector<float, 4>(_mm256_castps256_ps128(v));
+	}
+	Vector<float, 4> hi() const {
+		return Vector<float, 4>(_mm256_extractf128_ps(v, 1));
+	}
+	float& operator[](int i) {
+		return s[i];
+	}
+	const float& operator[](int i) const {
+		return s[i];
+	}
+};
+
+#define DECLARE_VECTOR_OPERATOR_COMPARE_256(operator, predicate) \
+	inline Vector<float, 8> operator(const Vector<float, 8>& a, const Vector<float, 8>& b) { \
+		return Vector<float, 8>(_mm256_cmp_ps(a.v, b.v, predicate)); \
+	}
+
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator+, _mm256_add_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator-, _mm256_sub_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator*, _mm256_mul_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator/, _mm256_div_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator^, _mm256_xor_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator&, _mm256_and_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 8, operator|, _mm256_or_ps)
+
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator==, _CMP_EQ_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator>=, _CMP_GE_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator>, _CMP_GT_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator<=, _CMP_LE_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator<, _CMP_LT_OQ)
+// Matches _mm_cmpneq_ps(), which is true for NaNs
+DECLARE_VECTOR_OPERATOR_COMPARE_256(operator!=, _CMP_NEQ_UQ)
+
+#endif // __AVX__
+
+
+#if defined(__AVX512F__)
+
+/** Wrapper for `__m512` representing an aligned vector of 16 single-precision float values.
+Requires AVX-512F.
+Comparisons return masks with all bits set per element, like the other vector types, rather than AVX-512 mask registers.
+*/
+template <>
+struct Vector<float, 16> {
+	using type = float;
+	constexpr static int size = 16;
+
+	union {
+		__m512 v;
+		float s[16];
+	};
+
+	Vector() = default;
+	Vector(__m512 v) : v(v) {}
+	Vector(float x) {
+		v = _mm512_set1_ps(x);
+	}
+	/** Constructs a vector from its lower and upper halves. */
+	Vector(Vector<float, 8> lo, Vector<float, 8> hi) {
+		v = _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo.v)), _mm256_castps_pd(hi.v), 1));
+	}
+	static Vector zero() {
+		return Vector(_mm512_setzero_ps());
+	}
+	static Vector mask() {
+		return Vector(_mm512_castsi512_ps(_mm512_set1_epi32(-1)));
+	}
+	/** Expands an AVX-512 mask register to a vector with all bits set for each set bit. */
+	static Vector fromMask(__mmask16 k) {
+		return Vector(_mm512_castsi512_ps(_mm512_maskz_set1_epi32(k, -1)));
+	}
+	static Vector load(const float* x) {
+		return Vector(_mm512_loadu_ps(x));
+	}
+	void store(float* x) {
+		_mm512_storeu_ps(x, v);
+	}
+	Vector<float, 8> lo() const {
+		return Vector<float, 8>(_mm512_castps512_ps256(v));
+	}
+	Vector<float, 8> hi() const {
+		return Vector<float, 8>(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+	}
+	float& operator[](int i) {
+		return s[i];
+	}
+	const float& operator[](int i) const {
+		return s[i];
+	}
+};
+
+// Bitwise float operations need AVX-512DQ, so operate on the integer representation instead.
+#define DECLARE_VECTOR_OPERATOR_BITWISE_512(operator, func) \
+	inline Vector<float, 16> operator(const Vector<float, 16>& a, const Vector<float, 16>& b) { \
+		return Vector<float, 16>(_mm512_castsi512_ps(func(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v)))); \
+	}
+
+#define DECLARE_VECTOR_OPERATOR_COMPARE_512(operator, predicate) \
+	inline Vector<float, 16> operator(const Vector<float, 16>& a, const Vector<float, 16>& b) { \
+		return Vector<float, 16>::fromMask(_mm512_cmp_ps_mask(a.v, b.v, predicate)); \
+	}
+
+DECLARE_VECTOR_OPERATOR_INFIX(float, 16, operator+, _mm512_add_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 16, operator-, _mm512_sub_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 16, operator*, _mm512_mul_ps)
+DECLARE_VECTOR_OPERATOR_INFIX(float, 16, operator/, _mm512_div_ps)
+DECLARE_VECTOR_OPERATOR_BITWISE_512(operator^, _mm512_xor_si512)
+DECLARE_VECTOR_OPERATOR_BITWISE_512(operator&, _mm512_and_si512)
+DECLARE_VECTOR_OPERATOR_BITWISE_512(operator|, _mm512_or_si512)
+
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator==, _CMP_EQ_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator>=, _CMP_GE_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator>, _CMP_GT_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator<=, _CMP_LE_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator<, _CMP_LT_OQ)
+DECLARE_VECTOR_OPERATOR_COMPARE_512(operator!=, _CMP_NEQ_UQ)
+
+#endif // __AVX512F__
+
+
+/** Declares the increment and unary operators of a float vector type in terms of its infix operators. */
+#define DECLARE_VECTOR_FLOAT_OPERATORS_DERIVED(s) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator+=, operator+) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator-=, operator-) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator*=, operator*) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator/=, operator/) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator^=, operator^) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator&=, operator&) \
+	DECLARE_VECTOR_OPERATOR_INCREMENT(float, s, operator|=, operator|) \
+	inline Vector<float, s> operator+(const Vector<float, s>& a) { \
+		return a; \
+	} \
+	inline Vector<float, s> operator-(const Vector<float, s>& a) { \
+		return 0.f - a; \
+	} \
+	inline Vector<float, s>& operator++(Vector<float, s>& a) { \
+		return a += 1.f; \
+	} \
+	inline Vector<float, s>& operator--(Vector<float, s>& a) { \
+		return a -= 1.f; \
+	} \
+	inline Vector<float, s> operator++(Vector<float, s>& a, int) { \
+		Vector<float, s> b = a; \
+		++a; \
+		return b; \
+	} \
+	inline Vector<float, s> operator--(Vector<float, s>& a, int) { \
+		Vector<float, s> b = a; \
+		--a; \
+		return b; \
+	} \
+	inline Vector<float, s> operator~(const Vector<float, s>& a) { \
+		return a ^ Vector<float, s>::mask(); \
+	}
+
+#if defined(__AVX__)
+DECLARE_VECTOR_FLOAT_OPERATORS_DERIVED(8)
+#endif
+#if defined(__AVX512F__)
+DECLARE_VECTOR_FLOAT_OPERATORS_DERIVED(16)
+#endif
+
+
 // Typedefs
 
 
 using float_4 = Vector<float, 4>;
 using int32_4 = Vector<int32_t, 4>;
+#if defined(__AVX__)
+using float_8 = Vector<float, 8>;
+#endif
+#if defined(__AVX512F__)
+using float_16 = Vector<float, 16>;
+#endif
+
+/** The widest float vector type supported by the compilation target.
+Use `float_N::size` to stride through channels, e.g. 16 polyphonic voices take one AVX-512, two AVX, or four SSE iterations.
+*/
+#if defined(__AVX512F__)
+using float_N = Vector<float, 16>;
+#elif defined(__AVX__)
+using float_N = Vector<float, 8>;
+#else
+using float_N = Vector<float, 4>;
+#endif
 
 
 } // namespace simd
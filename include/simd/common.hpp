@@ -6,3 +6,8 @@
 	#define SIMDE_ENABLE_NATIVE_ALIASES
 	#include <simde/x86/sse4.2.h>
 #endif
+
+// Wider vector types are only available when the compiler targets them, e.g. with -mavx or -mavx512f.
+#if defined(__AVX__) || defined(__AVX512F__)
+	#include <immintrin.h>
+#endif
@@ -187,6 +187,24 @@ inline float_4 round(float_4 a) {
 	return float_4(_mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
 }
 
+using std::frexp;
+
+/** Returns the mantissa of positive normal `x` in [0.5, 1), and sets `e` to the exponent, so that `x = m * 2^e`.
+*/
+inline float_4 frexp(float_4 x, float_4* e) {
+	int32_4 xi = int32_4::cast(x);
+	*e = float_4((xi >> 23) - 126);
+	return (x & float_4::cast(int32_4(~0x7f800000))) | 0.5f;
+}
+
+using std::ldexp;
+
+/** Returns `x * 2^e` for integer `e` in [-126, 127].
+*/
+inline float_4 ldexp(float_4 x, float_4 e) {
+	return x * float_4::cast((int32_4(e) + 127) << 23);
+}
+
 using std::fmod;
 
 inline float_4 fmod(float_4 a, float_4 b) {
@@ -274,5 +292,344 @@ inline float_4 sgn(float_4 x) {
 }
 
 
+// Wider vectors
+/* Functions with native instructions are declared for each width, as are frexp() and ldexp(), which manipulate exponent bits.
+exp(), log(), sin(), cos(), and the functions composed from them, like pow(), run at full width using the Cephes kernels below.
+Only tan(), atan(), and atan2() are split into halves and computed with the narrower vector type.
+*/
+
+/** Returns exp(x).
+Same algorithm and polynomial as sse_mathfun_exp_ps(), written with vector operators so it runs at the full width of `T`.
+*/
+template <typename T>
+T expCephes(T x) {
+	x = clamp(x, T(-88.3762626647949f), T(88.3762626647949f));
+	// exp(x) = exp(g + n ln(2)) = exp(g) 2^n
+	T n = floor(x * 1.44269504088896341f + 0.5f);
+	// Subtract n ln(2) in two parts for extra precision
+	x -= n * 0.693359375f;
+	x -= n * -2.12194440e-4f;
+	T z = x * x;
+	T y = 1.9875691500e-4f;
+	y = y * x + 1.3981999507e-3f;
+	y = y * x + 8.3334519073e-3f;
+	y = y * x + 4.1665795894e-2f;
+	y = y * x + 1.6666665459e-1f;
+	y = y * x + 5.0000001201e-1f;
+	y = y * z + x + 1.f;
+	return ldexp(y, n);
+}
+
+/** Returns log(x), or NaN for non-positive `x`.
+Same algorithm and polynomial as sse_mathfun_log_ps().
+*/
+template <typename T>
+T logCephes(T x) {
+	T invalid = (x <= 0.f);
+	// Cut off denormals
+	x = fmax(x, T(1.17549435e-38f));
+	T e;
+	x = frexp(x, &e);
+	// log(x) = log(2 m) + (e - 1) log(2) if m < sqrt(1/2)
+	T small = (x < 0.707106781186547524f);
+	e -= small & 1.f;
+	x = x - 1.f + (x & small);
+	T z = x * x;
+	T y = 7.0376836292e-2f;
+	y = y * x - 1.1514610310e-1f;
+	y = y * x + 1.1676998740e-1f;
+	y = y * x - 1.2420140846e-1f;
+	y = y * x + 1.4249322787e-1f;
+	y = y * x - 1.6668057665e-1f;
+	y = y * x + 2.0000714765e-1f;
+	y = y * x - 2.4999993993e-1f;
+	y = y * x + 3.3333331174e-1f;
+	y = y * x * z;
+	y += e * -2.12194440e-4f;
+	y -= z * 0.5f;
+	x += y;
+	x += e * 0.693359375f;
+	return x | invalid;
+}
+
+/** Returns sin(x), or cos(x) if `COS` is true.
+Same algorithm and polynomials as sse_mathfun_sin_ps() and sse_mathfun_cos_ps(), with the octant computed in floating point rather than with integer instructions.
+Precise for `|x|` up to about 8192.
+*/
+template <bool COS, typename T>
+T sinCosCephes(T x) {
+	T sign = x & -0.f;
+	x = fabs(x);
+	// Octant j, rounded up to even, so that x - j pi/4 is in [-pi/4, pi/4]
+	T j = floor(x * 1.27323954473516f);
+	j = 2.f * floor((j + 1.f) * 0.5f);
+	// The sign flips every 4 octants, and the polynomial every 2
+	T polyMask = (j - 4.f * floor(j * 0.25f) == 0.f);
+	if (COS) {
+		// cos(x) = sin(x + pi/2) is positive for (j - 2) mod 8 < 4
+		T j8 = j - 2.f;
+		j8 -= 8.f * floor(j8 * 0.125f);
+		sign = (j8 < 4.f) & -0.f;
+	}
+	else {
+		T j8 = j - 8.f * floor(j * 0.125f);
+		sign ^= (j8 >= 4.f) & -0.f;
+	}
+	// Extended precision modular arithmetic: x - j pi/4 in three parts
+	x -= j * 0.78515625f;
+	x -= j * 2.4187564849853515625e-4f;
+	x -= j * 3.77489497744594108e-8f;
+	T z = x * x;
+	// cos polynomial for [-pi/4, pi/4]
+	T y1 = 2.443315711809948e-5f;
+	y1 = y1 * z - 1.388731625493765e-3f;
+	y1 = y1 * z + 4.166664568298827e-2f;
+	y1 = y1 * z * z - z * 0.5f + 1.f;
+	// sin polynomial for [-pi/4, pi/4]
+	T y2 = -1.9515295891e-4f;
+	y2 = y2 * z + 8.3321608736e-3f;
+	y2 = y2 * z - 1.6666654611e-1f;
+	y2 = y2 * z * x + x;
+	T y = COS ? ifelse(polyMask, y1, y2) : ifelse(polyMask, y2, y1);
+	return y ^ sign;
+}
+
+
+/** Declares functions of `Vector<float, s>` which are composed from vector operators and other functions. */
+#define DECLARE_VECTOR_FUNCTIONS_COMPOSED(s) \
+	inline Vector<float, s> ifelse(Vector<float, s> mask, Vector<float, s> a, Vector<float, s> b) { \
+		return (a & mask) | andnot(mask, b); \
+	} \
+	inline Vector<float, s> fabs(Vector<float, s> a) { \
+		return andnot(Vector<float, s>(-0.f), a); \
+	} \
+	inline Vector<float, s> abs(Vector<float, s> a) { \
+		return fabs(a); \
+	} \
+	inline Vector<float, s> fmod(Vector<float, s> a, Vector<float, s> b) { \
+		return a - floor(a / b) * b; \
+	} \
+	inline Vector<float, s> hypot(Vector<float, s> a, Vector<float, s> b) { \
+		return sqrt(a * a + b * b); \
+	} \
+	inline Vector<float, s> abs(std::complex<Vector<float, s>> a) { \
+		return hypot(a.real(), a.imag()); \
+	} \
+	inline Vector<float, s> arg(std::complex<Vector<float, s>> a) { \
+		return atan2(a.imag(), a.real()); \
+	} \
+	inline Vector<float, s> clamp(Vector<float, s> x, Vector<float, s> a = 0.f, Vector<float, s> b = 1.f) { \
+		return fmin(fmax(x, a), b); \
+	} \
+	inline Vector<float, s> rescale(Vector<float, s> x, Vector<float, s> xMin, Vector<float, s> xMax, Vector<float, s> yMin, Vector<float, s> yMax) { \
+		return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin); \
+	} \
+	inline Vector<float, s> crossfade(Vector<float, s> a, Vector<float, s> b, Vector<float, s> p) { \
+		return a + (b - a) * p; \
+	} \
+	inline Vector<float, s> sgn(Vector<float, s> x) { \
+		Vector<float, s> signbit = x & -0.f; \
+		Vector<float, s> nonzero = (x != 0.f); \
+		return signbit | (nonzero & 1.f); \
+	}
+
+/** Declares a function of `Vector<float, s>` by applying the function of half the width to each half. */
+#define DECLARE_VECTOR_FUNCTION_SPLIT(s, func) \
+	inline Vector<float, s> func(Vector<float, s> x) { \
+		return Vector<float, s>(func(x.lo()), func(x.hi())); \
+	}
+
+#define DECLARE_VECTOR_FUNCTION_SPLIT2(s, func) \
+	inline Vector<float, s> func(Vector<float, s> x, Vector<float, s> y) { \
+		return Vector<float, s>(func(x.lo(), y.lo()), func(x.hi(), y.hi())); \
+	}
+
+/** Declares the transcendental functions of `Vector<float, s>` which use the Cephes kernels at full width, and pow(). */
+#define DECLARE_VECTOR_FUNCTIONS_CEPHES(s) \
+	inline Vector<float, s> log(Vector<float, s> x) { \
+		return logCephes(x); \
+	} \
+	inline Vector<float, s> log10(Vector<float, s> x) { \
+		return logCephes(x) / std::log(10.f); \
+	} \
+	inline Vector<float, s> log2(Vector<float, s> x) { \
+		return logCephes(x) / std::log(2.f); \
+	} \
+	inline Vector<float, s> exp(Vector<float, s> x) { \
+		return expCephes(x); \
+	} \
+	inline Vector<float, s> sin(Vector<float, s> x) { \
+		return sinCosCephes<false>(x); \
+	} \
+	inline Vector<float, s> cos(Vector<float, s> x) { \
+		return sinCosCephes<true>(x); \
+	} \
+	inline Vector<float, s> pow(Vector<float, s> a, Vector<float, s> b) { \
+		return exp(b * log(a)); \
+	} \
+	inline Vector<float, s> pow(float a, Vector<float, s> b) { \
+		return exp(b * std::log(a)); \
+	}
+
+/** Declares the transcendental functions of `Vector<float, s>` which are computed in halves with the sse_mathfun kernels. */
+#define DECLARE_VECTOR_FUNCTIONS_SPLIT(s) \
+	DECLARE_VECTOR_FUNCTION_SPLIT(s, tan) \
+	DECLARE_VECTOR_FUNCTION_SPLIT(s, atan) \
+	DECLARE_VECTOR_FUNCTION_SPLIT2(s, atan2)
+
+
+#if defined(__AVX__)
+
+inline float_8 andnot(float_8 a, float_8 b) {
+	return float_8(_mm256_andnot_ps(a.v, b.v));
+}
+
+/** For example, `movemask(float_8::mask())` returns 0xff. */
+inline int movemask(float_8 a) {
+	return _mm256_movemask_ps(a.v);
+}
+
+inline float_8 rsqrt(float_8 x) {
+	return float_8(_mm256_rsqrt_ps(x.v));
+}
+
+inline float_8 rcp(float_8 x) {
+	return float_8(_mm256_rcp_ps(x.v));
+}
+
+template <>
+inline float_8 movemaskInverse<float_8>(int a) {
+	return float_8(movemaskInverse<float_4>(a), movemaskInverse<float_4>(a >> 4));
+}
+
+inline float_8 fmax(float_8 x, float_8 b) {
+	return float_8(_mm256_max_ps(x.v, b.v));
+}
+
+inline float_8 fmin(float_8 x, float_8 b) {
+	return float_8(_mm256_min_ps(x.v, b.v));
+}
+
+inline float_8 sqrt(float_8 x) {
+	return float_8(_mm256_sqrt_ps(x.v));
+}
+
+inline float_8 trunc(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+
+inline float_8 floor(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+
+inline float_8 ceil(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+
+inline float_8 round(float_8 a) {
+	return float_8(_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+// Shifting 8 integers requires AVX2, so plain AVX splits these into halves.
+inline float_8 frexp(float_8 x, float_8* e) {
+#if defined(__AVX2__)
+	__m256i xi = _mm256_castps_si256(x.v);
+	*e = float_8(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(xi, 23), _mm256_set1_epi32(126))));
+	return (x & float_8(_mm256_castsi256_ps(_mm256_set1_epi32(~0x7f800000)))) | 0.5f;
+#else
+	float_4 eLo, eHi;
+	float_8 m(frexp(x.lo(), &eLo), frexp(x.hi(), &eHi));
+	*e = float_8(eLo, eHi);
+	return m;
+#endif
+}
+
+inline float_8 ldexp(float_8 x, float_8 e) {
+#if defined(__AVX2__)
+	__m256i ei = _mm256_add_epi32(_mm256_cvttps_epi32(e.v), _mm256_set1_epi32(127));
+	return x * float_8(_mm256_castsi256_ps(_mm256_slli_epi32(ei, 23)));
+#else
+	return float_8(ldexp(x.lo(), e.lo()), ldexp(x.hi(), e.hi()));
+#endif
+}
+
+DECLARE_VECTOR_FUNCTIONS_SPLIT(8)
+DECLARE_VECTOR_FUNCTIONS_COMPOSED(8)
+DECLARE_VECTOR_FUNCTIONS_CEPHES(8)
+
+#endif // __AVX__
+
+
+#if defined(__AVX512F__)
+
+inline float_16 andnot(float_16 a, float_16 b) {
+	return float_16(_mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v))));
+}
+
+/** For example, `movemask(float_16::mask())` returns 0xffff. */
+inline int movemask(float_16 a) {
+	// Sign bit set <=> negative as an integer
+	return _mm512_cmplt_epi32_mask(_mm512_castps_si512(a.v), _mm512_setzero_si512());
+}
+
+/** Relative error is less than 2^-14. */
+inline float_16 rsqrt(float_16 x) {
+	return float_16(_mm512_rsqrt14_ps(x.v));
+}
+
+/** Relative error is less than 2^-14. */
+inline float_16 rcp(float_16 x) {
+	return float_16(_mm512_rcp14_ps(x.v));
+}
+
+template <>
+inline float_16 movemaskInverse<float_16>(int a) {
+	return float_16::fromMask(a);
+}
+
+inline float_16 fmax(float_16 x, float_16 b) {
+	return float_16(_mm512_max_ps(x.v, b.v));
+}
+
+inline float_16 fmin(float_16 x, float_16 b) {
+	return float_16(_mm512_min_ps(x.v, b.v));
+}
+
+inline float_16 sqrt(float_16 x) {
+	return float_16(_mm512_sqrt_ps(x.v));
+}
+
+inline float_16 trunc(float_16 a) {
+	return float_16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+
+inline float_16 floor(float_16 a) {
+	return float_16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+}
+
+inline float_16 ceil(float_16 a) {
+	return float_16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC));
+}
+
+inline float_16 round(float_16 a) {
+	return float_16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+inline float_16 frexp(float_16 x, float_16* e) {
+	*e = float_16(_mm512_getexp_ps(x.v)) + 1.f;
+	return float_16(_mm512_getmant_ps(x.v, _MM_MANT_NORM_p5_1, _MM_MANT_SIGN_src));
+}
+
+inline float_16 ldexp(float_16 x, float_16 e) {
+	return float_16(_mm512_scalef_ps(x.v, e.v));
+}
+
+DECLARE_VECTOR_FUNCTIONS_SPLIT(16)
+DECLARE_VECTOR_FUNCTIONS_COMPOSED(16)
+DECLARE_VECTOR_FUNCTIONS_CEPHES(16)
+
+#endif // __AVX512F__
+
+
 } // namespace simd
 } // namespace rack
@@ -5,6 +5,7 @@
 #include <app/RackWidget.hpp>
 #include <app/ModuleWidget.hpp>
 #include <context.hpp>
+#include <window/Window.hpp>
 #include <asset.hpp>
 #include <settings.hpp>
 #include <engine/Engine.hpp>
@@ -45,6 +46,9 @@ struct PlugWidget : widget::Widget {
 	widget::SvgWidget* plugPort;
 
 	app::MultiLightWidget* plugLight;
+	/** Red, green, and blue brightness of the plug light, smoothed in the UI thread */
+	engine::Light lights[3];
+	const engine::PortSummary* summary = NULL;
 
 	PlugWidget() {
 		fb = new widget::FramebufferWidget;
@@ -77,12 +81,29 @@ struct PlugWidget : widget::Widget {
 
 	void step() override {
 		std::vector<float> values(3);
-		if (portWidget && plugLight->isVisible()) {
-			engine::Port* port = portWidget->getPort();
-			if (port) {
-				for (int i = 0; i < 3; i++) {
-					values[i] = port->plugLights[i].getBrightness();
-				}
+		if (plugLight->isVisible()) {
+			float deltaTime = APP->window->getLastFrameDuration();
+			if (!std::isfinite(deltaTime))
+				deltaTime = 0.f;
+			// Same colors and decay as engine lights
+			if (!summary || summary->channels == 0) {
+				lights[0].setBrightness(0.f);
+				lights[1].setBrightness(0.f);
+				lights[2].setBrightness(0.f);
+			}
+			else if (summary->channels == 1) {
+				float v = summary->mean / 10.f;
+				lights[0].setBrightnessSmooth(-v, deltaTime);
+				lights[1].setBrightnessSmooth(v, deltaTime);
+				lights[2].setBrightness(0.f);
+			}
+			else {
+				lights[0].setBrightness(0.f);
+				lights[1].setBrightness(0.f);
+				lights[2].setBrightnessSmooth(summary->rms / 10.f, deltaTime);
+			}
+			for (int i = 0; i < 3; i++) {
+				values[i] = lights[i].getBrightness();
 			}
 		}
 		plugLight->setBrightnesses(values);
@@ -110,6 +131,10 @@ struct PlugWidget : widget::Widget {
 		this->portWidget = portWidget;
 	}
 
+	void setSummary(const engine::PortSummary* summary) {
+		this->summary = summary;
+	}
+
 	void setTop(bool top) {
 		plugLight->setVisible(top);
 	}
@@ -257,6 +282,18 @@ void CableWidget::step() {
 	NVGcolor colorOpaque = color;
 	colorOpaque.a = 1.f;
 
+	// Plug lights show the voltages of this cable, or of the top cable on the port an incomplete cable is plugged into
+	const engine::PortSummary* summary = NULL;
+	if (cable) {
+		summary = APP->engine->getPortSummary(cable->id);
+	}
+	else {
+		PortWidget* port = outputPort ? outputPort : inputPort;
+		CableWidget* topCable = port ? APP->scene->rack->getTopCable(port) : NULL;
+		if (topCable && topCable->cable)
+			summary = APP->engine->getPortSummary(topCable->cable->id);
+	}
+
 	// Draw output plug
 	bool outputTop = !isComplete() || APP->scene->rack->getTopCable(outputPort) == this;
 	outputPlug->setPosition(outputPos);
@@ -264,6 +301,7 @@ void CableWidget::step() {
 	outputPlug->setAngle(slump.minus(outputPos).arg());
 	outputPlug->setColor(colorOpaque);
 	outputPlug->setPortWidget(outputPort);
+	outputPlug->setSummary(summary);
 
 	// Draw input plug
 	bool inputTop = !isComplete() || APP->scene->rack->getTopCable(inputPort) == this;
@@ -272,6 +310,7 @@ void CableWidget::step() {
 	inputPlug->setAngle(slump.minus(inputPos).arg());
 	inputPlug->setColor(colorOpaque);
 	inputPlug->setPortWidget(inputPort);
+	inputPlug->setSummary(summary);
 
 	Widget::step();
 }
@@ -2,6 +2,7 @@
 #include <app/Scene.hpp>
 #include <context.hpp>
 #include <settings.hpp>
+#include <engine/Engine.hpp>
 
 
 namespace rack {
@@ -113,8 +114,14 @@ void ModuleLightWidget::step() {
 			// Leave lights off
 		}
 		else if (0 <= firstLightId && lastLightId <= (int) module->lights.size()) {
+			// Read the engine's snapshot of the module's lights rather than the lights it is writing.
+			// Modules outside the engine, or added since the last snapshot, have none.
+			int lightsLen = 0;
+			const float* snapshot = APP->engine->getLightSnapshot(module->id, &lightsLen);
+			if (lastLightId > lightsLen)
+				snapshot = NULL;
 			for (size_t i = 0; i < baseColors.size(); i++) {
-				float b = module->lights[firstLightId + i].getBrightness();
+				float b = snapshot ? snapshot[firstLightId + i] : module->lights[firstLightId + i].getBrightness();
 				if (!std::isfinite(b))
 					b = 0.f;
 				b = math::clamp(b, 0.f, 1.f);
@@ -119,6 +119,9 @@ RackWidget::~RackWidget() {
 }
 
 void RackWidget::step() {
+	// Take the engine's latest port summaries and light snapshot once for all plug and module lights
+	APP->engine->updatePortSummaries();
+	APP->engine->updateLightSnapshot();
 	Widget::step();
 }
 
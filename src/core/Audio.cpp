@@ -12,6 +12,71 @@ namespace rack {
 namespace core {
 
 
+/** Time constant of the fill error smoothing filter, in seconds */
+static const double DriftController_smoothingTau = 2.0;
+/** Natural period of the critically damped control loop, in seconds */
+static const double DriftController_period = 30.0;
+/** Maximum ratio correction, far above the drift of real audio clocks */
+static const double DriftController_maxCorrection = 0.002;
+/** Step of the ratio correction passed to the resampler.
+Each change makes Speex recompute its filter on the audio thread, so the correction is quantized.
+*/
+static const double DriftController_correctionStep = 10e-6;
+/** Minimum time between changes of the ratio correction, in seconds */
+static const double DriftController_updateInterval = 1.0;
+
+
+/** Steers the fill level of a buffer between a non-master audio device and the engine toward a target.
+The device and the master device run on independent clocks, so rather than dropping or inserting frames when the buffer drifts, a PI controller slightly adjusts the sample rate conversion ratio.
+*/
+struct DriftController {
+	/** Smoothed fill error in seconds */
+	double error = 0.0;
+	/** Integral of the fill error in seconds^2 */
+	double integral = 0.0;
+	/** Unquantized output of the controller, relative to 1 */
+	double control = 0.0;
+	/** Ratio correction to pass to SampleRateConverter::setRatioCorrection(), quantized to DriftController_correctionStep */
+	double correction = 1.0;
+	/** Time since the correction last changed, in seconds */
+	double updateTime = 0.0;
+
+	void reset() {
+		error = 0.0;
+		integral = 0.0;
+		control = 0.0;
+		correction = 1.0;
+		updateTime = 0.0;
+	}
+
+	/** Updates the controller once per device block.
+	`fillError` is the buffer fill minus its target, and `deltaTime` is the duration of the block, both in seconds.
+	Returns the correction, which changes at most once per DriftController_updateInterval.
+	*/
+	double process(double fillError, double deltaTime) {
+		const double omega = 2 * M_PI / DriftController_period;
+		const double kp = 2 * omega;
+		const double ki = omega * omega;
+		error += (fillError - error) * std::min(deltaTime / DriftController_smoothingTau, 1.0);
+		integral += error * deltaTime;
+		// Prevent windup when the correction is saturated
+		integral = std::max(std::min(integral, DriftController_maxCorrection / ki), -DriftController_maxCorrection / ki);
+		// A buffer that is too full needs fewer output frames per input frame
+		double c = -(kp * error + ki * integral);
+		control = std::max(std::min(c, DriftController_maxCorrection), -DriftController_maxCorrection);
+
+		// Quantize with hysteresis, so a control wobbling around a step boundary, or around exactly 1 when both devices share a clock, doesn't change the resampler.
+		updateTime += deltaTime;
+		double current = correction - 1.0;
+		if (updateTime >= DriftController_updateInterval && std::fabs(control - current) >= 0.75 * DriftController_correctionStep) {
+			correction = 1.0 + std::round(control / DriftController_correctionStep) * DriftController_correctionStep;
+			updateTime = 0.0;
+		}
+		return correction;
+	}
+};
+
+
 template <int NUM_AUDIO_INPUTS, int NUM_AUDIO_OUTPUTS>
 struct AudioPort : audio::Port {
 	Module* module;
@@ -28,6 +93,32 @@ struct AudioPort : audio::Port {
 	float deviceSampleRate = 0.f;
 	int requestedEngineFrames = 0;
 
+	/** Whether the engine reads and writes the device buffers directly during processBuffer().
+	Only possible for the master module when the engine and device sample rates are equal, so no resampling or buffering is needed.
+	*/
+	bool direct = false;
+	// Device buffers, only valid while the engine is stepped by processBuffer()
+	const float* directInput = NULL;
+	int directInputStride = 0;
+	float* directOutput = NULL;
+	int directOutputStride = 0;
+	int directFrames = 0;
+	/** Index of the next frame to read and write */
+	int directFrame = 0;
+
+	// Adaptive resampling bridge, used when not master
+	DriftController outputDrift;
+	DriftController inputDrift;
+	/** Whether the engine buffers have been filled to their target since the stream started or the last dropout */
+	bool outputPrimed = false;
+	bool inputPrimed = false;
+	// Stats, written by the audio thread and displayed in the context menu
+	/** Engine buffer fill levels in seconds, compensated for the engine running ahead of real time */
+	double outputFill = 0.0;
+	double inputFill = 0.0;
+	/** Number of times an engine buffer ran empty or had to be cleared */
+	int dropoutCount = 0;
+
 	AudioPort(Module* module) {
 		this->module = module;
 		maxOutputs = NUM_AUDIO_INPUTS;
@@ -71,20 +162,51 @@ struct AudioPort : audio::Port {
 		float engineSampleRate = APP->engine->getSampleRate();
 		float sampleRateRatio = engineSampleRate / deviceSampleRate;
 
-		// DEBUG("%p: %d block, engineOutputBuffer still has %d", this, frames, (int) engineOutputBuffer.size());
-
-		// Consider engine buffers "too full" if they contain a bit more than the audio device's number of frames, converted to engine sample rate.
-		int maxEngineFrames = (int) std::ceil(frames * sampleRateRatio * 2.0) - 1;
-		// If the engine output buffer is too full, clear it to keep latency low. No need to clear if master because it's always cleared below.
-		if (!isMasterCached && (int) engineOutputBuffer.size() > maxEngineFrames) {
+		// Bypass sample rate conversion and engine buffers if possible
+		direct = isMasterCached && engineSampleRate == deviceSampleRate;
+		if (direct) {
+			engineInputBuffer.clear();
 			engineOutputBuffer.clear();
-			// DEBUG("%p: clearing engine output", this);
+			requestedEngineFrames = frames;
+			return;
 		}
 
+		// DEBUG("%p: %d block, engineOutputBuffer still has %d", this, frames, (int) engineOutputBuffer.size());
+
 		if (deviceNumInputs > 0) {
-			// Always clear engine output if master
 			if (isMasterCached) {
+				// Always clear engine output if master
 				engineOutputBuffer.clear();
+				outputSrc.setRatioCorrection(1.0);
+				outputSrc.setBypassEnabled(true);
+				outputPrimed = false;
+			}
+			else {
+				// The engine consumes the buffer in blocks ahead of real time, so measure the fill as if it consumed frames at its sample rate.
+				double target = getBridgeTarget(frames * sampleRateRatio);
+				double lead = getEngineLead(engineSampleRate);
+				double fill = engineOutputBuffer.size() + lead;
+				if (outputPrimed && (engineOutputBuffer.empty() || fill > 4 * target)) {
+					// Dropout
+					outputPrimed = false;
+					dropoutCount++;
+				}
+				if (!outputPrimed) {
+					// Pad with silence up to the target fill
+					engineOutputBuffer.clear();
+					int padFrames = math::clamp((int) std::ceil(target - lead), 0, (int) engineOutputBuffer.capacity() / 2);
+					for (int i = 0; i < padFrames; i++) {
+						engineOutputBuffer.push(dsp::Frame<NUM_AUDIO_OUTPUTS>{});
+					}
+					fill = target;
+					outputDrift.reset();
+					outputPrimed = true;
+				}
+				outputFill = fill / engineSampleRate;
+				double correction = outputDrift.process((fill - target) / engineSampleRate, frames / deviceSampleRate);
+				// The correction may return to exactly 1 at equal sample rates
+				outputSrc.setBypassEnabled(false);
+				outputSrc.setRatioCorrection(correction);
 			}
 			// Set up sample rate converter
 			outputSrc.setRates(deviceSampleRate, engineSampleRate);
@@ -103,6 +225,20 @@ struct AudioPort : audio::Port {
 	}
 
 	void processBuffer(const float* input, int inputStride, float* output, int outputStride, int frames) override {
+		if (direct) {
+			// Step engine, which reads and writes the device buffers in Audio::process()
+			directInput = input;
+			directInputStride = inputStride;
+			directOutput = output;
+			directOutputStride = outputStride;
+			directFrames = frames;
+			directFrame = 0;
+			APP->engine->stepBlock(frames);
+			directInput = NULL;
+			directOutput = NULL;
+			return;
+		}
+
 		// Step engine
 		if (isMaster() && requestedEngineFrames > 0) {
 			// DEBUG("%p: %d block, stepping %d", this, frames, requestedEngineFrames);
@@ -111,31 +247,69 @@ struct AudioPort : audio::Port {
 	}
 
 	void processOutput(float* output, int outputStride, int frames) override {
-		// bool isMasterCached = isMaster();
+		if (direct) {
+			// The engine has already written to the audio output buffer
+			if (deviceNumOutputs > 0)
+				clampOutput(output, outputStride, directFrame, frames);
+			return;
+		}
+
+		bool isMasterCached = isMaster();
 		float engineSampleRate = APP->engine->getSampleRate();
 		float sampleRateRatio = engineSampleRate / deviceSampleRate;
 
 		if (deviceNumOutputs > 0) {
-			// Set up sample rate converter
-			inputSrc.setRates(engineSampleRate, deviceSampleRate);
-			inputSrc.setChannels(deviceNumOutputs);
-			// Convert engine input -> audio output
-			int inputFrames = engineInputBuffer.size();
-			int outputFrames = frames;
-			inputSrc.process((const float*) engineInputBuffer.startData(), NUM_AUDIO_INPUTS, &inputFrames, output, outputStride, &outputFrames);
-			engineInputBuffer.startIncr(inputFrames);
-			// Clamp output samples
-			for (int i = 0; i < outputFrames; i++) {
-				for (int j = 0; j < deviceNumOutputs; j++) {
-					float v = output[i * outputStride + j];
-					v = clamp(v, -1.f, 1.f);
-					output[i * outputStride + j] = v;
+			bool silent = false;
+			if (isMasterCached) {
+				inputSrc.setRatioCorrection(1.0);
+				inputSrc.setBypassEnabled(true);
+				inputPrimed = false;
+			}
+			else {
+				// The engine fills the buffer in blocks ahead of real time, so measure the fill as if it produced frames at its sample rate.
+				double target = getBridgeTarget(frames * sampleRateRatio);
+				double fill = engineInputBuffer.size() - getEngineLead(engineSampleRate);
+				inputFill = fill / engineSampleRate;
+				if (inputPrimed && fill > 4 * target) {
+					// Dropout
+					engineInputBuffer.clear();
+					inputPrimed = false;
+					dropoutCount++;
 				}
+				if (!inputPrimed) {
+					// Output silence until the engine has filled the buffer to its target
+					if (fill >= target) {
+						inputDrift.reset();
+						inputPrimed = true;
+					}
+					else {
+						silent = true;
+					}
+				}
+				if (inputPrimed) {
+					double correction = inputDrift.process((fill - target) / engineSampleRate, frames / deviceSampleRate);
+					inputSrc.setBypassEnabled(false);
+					inputSrc.setRatioCorrection(correction);
+				}
+			}
+
+			if (silent) {
+				clampOutput(output, outputStride, 0, frames);
 			}
-			// Fill the rest of the audio output buffer with zeros
-			for (int i = outputFrames; i < frames; i++) {
-				for (int j = 0; j < deviceNumOutputs; j++) {
-					output[i * outputStride + j] = 0.f;
+			else {
+				// Set up sample rate converter
+				inputSrc.setRates(engineSampleRate, deviceSampleRate);
+				inputSrc.setChannels(deviceNumOutputs);
+				// Convert engine input -> audio output
+				int inputFrames = engineInputBuffer.size();
+				int outputFrames = frames;
+				inputSrc.process((const float*) engineInputBuffer.startData(), NUM_AUDIO_INPUTS, &inputFrames, output, outputStride, &outputFrames);
+				engineInputBuffer.startIncr(inputFrames);
+				clampOutput(output, outputStride, outputFrames, frames);
+				if (!isMasterCached && outputFrames < frames) {
+					// Dropout
+					inputPrimed = false;
+					dropoutCount++;
 				}
 			}
 		}
@@ -144,7 +318,7 @@ struct AudioPort : audio::Port {
 
 		// If the engine input buffer is too full, clear it to keep latency low.
 		int maxEngineFrames = (int) std::ceil(frames * sampleRateRatio * 2.0) - 1;
-		if ((int) engineInputBuffer.size() > maxEngineFrames) {
+		if (isMasterCached && (int) engineInputBuffer.size() > maxEngineFrames) {
 			engineInputBuffer.clear();
 			// DEBUG("%p: clearing engine input", this);
 		}
@@ -152,9 +326,48 @@ struct AudioPort : audio::Port {
 		// DEBUG("%p %s:\tframes %d requestedEngineFrames %d\toutputBuffer %d engineInputBuffer %d\t", this, isMasterCached ? "master" : "secondary", frames, requestedEngineFrames, engineOutputBuffer.size(), engineInputBuffer.size());
 	}
 
+	/** Returns the number of frames the engine has processed ahead of the master device's real-time position.
+The engine steps each block as fast as possible, so the engine buffers of a non-master device jump by a block at a time.
+*/
+	double getEngineLead(float engineSampleRate) {
+		double blockDuration = APP->engine->getBlockDuration();
+		double elapsed = system::getTime() - APP->engine->getBlockTime();
+		elapsed = std::max(std::min(elapsed, 2 * blockDuration), 0.0);
+		int64_t blockProgress = APP->engine->getFrame() - APP->engine->getBlockFrame();
+		return blockProgress - elapsed * engineSampleRate;
+	}
+
+	/** Returns the target fill of the engine buffers in engine frames, given the device block size in engine frames.
+	Allows for a full engine block and device block to be in flight, plus margin for callback jitter.
+	*/
+	double getBridgeTarget(double deviceBlockFrames) {
+		return 1.5 * (APP->engine->getBlockFrames() + deviceBlockFrames);
+	}
+
+	/** Clamps the first `outputFrames` frames of the audio output buffer and fills the rest with zeros. */
+	void clampOutput(float* output, int outputStride, int outputFrames, int frames) {
+		// Clamp output samples
+		for (int i = 0; i < outputFrames; i++) {
+			for (int j = 0; j < deviceNumOutputs; j++) {
+				float v = output[i * outputStride + j];
+				v = clamp(v, -1.f, 1.f);
+				output[i * outputStride + j] = v;
+			}
+		}
+		// Fill the rest of the audio output buffer with zeros
+		for (int i = outputFrames; i < frames; i++) {
+			for (int j = 0; j < deviceNumOutputs; j++) {
+				output[i * outputStride + j] = 0.f;
+			}
+		}
+	}
+
 	void onStartStream() override {
 		engineInputBuffer.clear();
 		engineOutputBuffer.clear();
+		outputPrimed = false;
+		inputPrimed = false;
+		dropoutCount = 0;
 		// DEBUG("onStartStream");
 	}
 
@@ -291,7 +504,16 @@ struct Audio : Module {
 				}
 			}
 
-			if (!port.engineInputBuffer.full()) {
+			if (port.directOutput) {
+				// Write directly to audio output buffer
+				if (port.directFrame < port.directFrames) {
+					float* output = &port.directOutput[port.directFrame * port.directOutputStride];
+					for (int i = 0; i < port.deviceNumOutputs; i++) {
+						output[i] = inputFrame.samples[i];
+					}
+				}
+			}
+			else if (!port.engineInputBuffer.full()) {
 				port.engineInputBuffer.push(inputFrame);
 			}
 
@@ -311,9 +533,19 @@ struct Audio : Module {
 			}
 		}
 
-		// Pull outputs from buffer
-		if (!port.engineOutputBuffer.empty()) {
-			dsp::Frame<NUM_AUDIO_OUTPUTS> outputFrame = port.engineOutputBuffer.shift();
+		// Pull outputs from audio input buffer or engine buffer
+		bool directInput = port.directInput && port.deviceNumInputs > 0 && port.directFrame < port.directFrames;
+		if (directInput || !port.engineOutputBuffer.empty()) {
+			dsp::Frame<NUM_AUDIO_OUTPUTS> outputFrame;
+			if (directInput) {
+				const float* input = &port.directInput[port.directFrame * port.directInputStride];
+				for (int i = 0; i < NUM_AUDIO_OUTPUTS; i++) {
+					outputFrame.samples[i] = (i < port.deviceNumInputs) ? input[i] : 0.f;
+				}
+			}
+			else {
+				outputFrame = port.engineOutputBuffer.shift();
+			}
 			for (int i = 0; i < NUM_AUDIO_OUTPUTS; i++) {
 				float v = outputFrame.samples[i];
 				outputs[AUDIO_OUTPUTS + i].setVoltage(10.f * v);
@@ -332,6 +564,9 @@ struct Audio : Module {
 			}
 		}
 
+		if (port.directOutput || port.directInput)
+			port.directFrame++;
+
 		// Lights
 		if (lightDivider.process()) {
 			float lightTime = args.sampleTime * lightDivider.getDivision();
@@ -614,6 +849,19 @@ struct AudioWidget : ModuleWidget {
 		));
 
 		menu->addChild(createBoolPtrMenuItem("DC blocker", "", &module->dcFilterEnabled));
+
+		// Adaptive resampling stats
+		if (!module->port.isMaster() && module->port.deviceSampleRate > 0.f) {
+			menu->addChild(new MenuSeparator);
+			menu->addChild(createMenuLabel("Clock drift compensation"));
+			if (module->port.deviceNumInputs > 0) {
+				menu->addChild(createMenuLabel(string::f("Input: %+.1f ppm, %.1f ms buffered", (module->port.outputDrift.correction - 1.0) * 1e6, module->port.outputFill * 1000)));
+			}
+			if (module->port.deviceNumOutputs > 0) {
+				menu->addChild(createMenuLabel(string::f("Output: %+.1f ppm, %.1f ms buffered", (module->port.inputDrift.correction - 1.0) * 1e6, module->port.inputFill * 1000)));
+			}
+			menu->addChild(createMenuLabel(string::f("Dropouts: %d", module->port.dropoutCount)));
+		}
 	}
 };
 
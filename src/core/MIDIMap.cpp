@@ -46,6 +46,21 @@ struct MIDIMap : Module {
 	bool filterInitialized[MAX_CHANNELS] = {};
 	dsp::ClockDivider divider;
 
+	/** The first map ID of each CC number, or -1 if unmapped */
+	int ccFirstIds[128];
+	/** The next map ID with the same CC number, or -1 */
+	int ccNextIds[MAX_CHANNELS];
+	/** IDs of maps whose param is still approaching its CC value */
+	int activeIds[MAX_CHANNELS];
+	int activeLen = 0;
+	bool active[MAX_CHANNELS] = {};
+	/** Set when maps change, so the engine thread activates all maps */
+	std::atomic<bool> activateAll{true};
+	/** The module of each map's ParamHandle when last checked.
+	The Engine sets ParamHandle modules when modules are added or removed without notifying the map, so maps whose module changed are activated.
+	*/
+	Module* handleModules[MAX_CHANNELS] = {};
+
 	MIDIMap() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
 		for (int id = 0; id < MAX_CHANNELS; id++) {
@@ -89,45 +104,111 @@ struct MIDIMap : Module {
 			processMessage(msg);
 		}
 
-		// Step channels
+		if (activateAll.exchange(false)) {
+			for (int id = 0; id < mapLen; id++) {
+				if (ccs[id] >= 0)
+					activateMap(id);
+			}
+		}
+
+		// Maps are deactivated while their module is missing, so activate them when it is added
 		for (int id = 0; id < mapLen; id++) {
-			int cc = ccs[id];
-			if (cc < 0)
-				continue;
-			// Get Module
 			Module* module = paramHandles[id].module;
-			if (!module)
-				continue;
-			// Get ParamQuantity from ParamHandle
-			int paramId = paramHandles[id].paramId;
-			ParamQuantity* paramQuantity = module->paramQuantities[paramId];
-			if (!paramQuantity)
-				continue;
-			if (!paramQuantity->isBounded())
-				continue;
-			// Set filter from param value if filter is uninitialized
-			if (!filterInitialized[id]) {
-				valueFilters[id].out = paramQuantity->getScaledValue();
-				filterInitialized[id] = true;
+			if (module == handleModules[id])
 				continue;
-			}
-			// Check if CC has been set by the MIDI device
-			if (values[cc] < 0)
-				continue;
-			float value = values[cc] / 127.f;
-			// Detect behavior from MIDI buttons.
-			if (smooth && std::fabs(valueFilters[id].out - value) < 1.f) {
-				// Smooth value with filter
-				valueFilters[id].process(args.sampleTime * divider.getDivision(), value);
+			handleModules[id] = module;
+			// Start smoothing from the new param's value
+			filterInitialized[id] = false;
+			if (ccs[id] >= 0)
+				activateMap(id);
+		}
+
+		// Step only the maps whose CC changed or whose filter hasn't settled
+		int i = 0;
+		while (i < activeLen) {
+			int id = activeIds[i];
+			if (stepMap(id, args.sampleTime * divider.getDivision())) {
+				i++;
 			}
 			else {
-				// Jump value
-				valueFilters[id].out = value;
+				// Remove from active list
+				active[id] = false;
+				activeIds[i] = activeIds[--activeLen];
 			}
-			paramQuantity->setScaledValue(valueFilters[id].out);
 		}
 	}
 
+	/** Writes the smoothed CC value of a map to its param.
+	Returns whether the map should be stepped again next time.
+	*/
+	bool stepMap(int id, float deltaTime) {
+		int cc = ccs[id];
+		if (cc < 0)
+			return false;
+		// Check if CC has been set by the MIDI device
+		if (values[cc] < 0)
+			return false;
+		// Get Module
+		Module* module = paramHandles[id].module;
+		if (!module)
+			return false;
+		// Get ParamQuantity from ParamHandle
+		int paramId = paramHandles[id].paramId;
+		ParamQuantity* paramQuantity = module->paramQuantities[paramId];
+		if (!paramQuantity)
+			return false;
+		if (!paramQuantity->isBounded())
+			return false;
+		// Set filter from param value if filter is uninitialized
+		if (!filterInitialized[id]) {
+			valueFilters[id].out = paramQuantity->getScaledValue();
+			filterInitialized[id] = true;
+		}
+		float value = values[cc] / 127.f;
+		bool settled;
+		// Detect behavior from MIDI buttons.
+		if (smooth && std::fabs(valueFilters[id].out - value) < 1.f) {
+			// Smooth value with filter
+			valueFilters[id].process(deltaTime, value);
+			// Snap to value once the difference is well below one CC step
+			settled = (std::fabs(valueFilters[id].out - value) < 1e-4f);
+			if (settled)
+				valueFilters[id].out = value;
+		}
+		else {
+			// Jump value
+			valueFilters[id].out = value;
+			settled = true;
+		}
+		paramQuantity->setScaledValue(valueFilters[id].out);
+		return !settled;
+	}
+
+	void activateMap(int id) {
+		if (active[id])
+			return;
+		active[id] = true;
+		activeIds[activeLen++] = id;
+	}
+
+	/** Rebuilds the CC-to-map index, and requests all maps to be activated so their params receive the current CC values.
+	Each map's next ID is always greater than its own, so traversing the index while it's rebuilt still terminates.
+	*/
+	void updateCcIndex() {
+		for (int cc = 0; cc < 128; cc++) {
+			ccFirstIds[cc] = -1;
+		}
+		for (int id = MAX_CHANNELS - 1; id >= 0; id--) {
+			int cc = ccs[id];
+			ccNextIds[id] = -1;
+			if (!(0 <= cc && cc < 128))
+				continue;
+			ccNextIds[id] = ccFirstIds[cc];
+			ccFirstIds[cc] = id;
+		}
+		activateAll = true;
+	}
+
 	void processMessage(const midi::Message& msg) {
 		// DEBUG("MIDI: %01x %01x %02x %02x", msg.getStatus(), msg.getChannel(), msg.getNote(), msg.getValue());
 
@@ -155,7 +236,13 @@ struct MIDIMap : Module {
 		// Ignore negative values generated using the nonstandard 8-bit MIDI extension from the gamepad driver
 		if (value < 0)
 			return;
+		if (values[cc] == value)
+			return;
 		values[cc] = value;
+		// Activate all maps of this CC
+		for (int id = ccFirstIds[cc]; id >= 0; id = ccNextIds[id]) {
+			activateMap(id);
+		}
 	}
 
 	void clearMap(int id) {
@@ -176,6 +263,7 @@ struct MIDIMap : Module {
 			refreshParamHandleText(id);
 		}
 		mapLen = 0;
+		updateCcIndex();
 	}
 
 	void updateMapLen() {
@@ -189,6 +277,7 @@ struct MIDIMap : Module {
 		// Add an empty "Mapping..." slot
 		if (mapLen < MAX_CHANNELS)
 			mapLen++;
+		updateCcIndex();
 	}
 
 	void commitLearn() {
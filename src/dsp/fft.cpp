@@ -0,0 +1,112 @@
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <dsp/fft.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/** Maximum total size of released buffers kept in the pool, in floats */
+static const size_t FftCache_maxPoolSize = 4 << 20;
+
+
+struct FftCache {
+	struct Setup {
+		PFFFT_Setup* setup;
+		int refCount;
+	};
+
+	std::mutex setupMutex;
+	std::map<std::tuple<int, int>, Setup> setups;
+	/** Setup pointer -> key, for releasing */
+	std::map<PFFFT_Setup*, std::tuple<int, int>> setupKeys;
+
+	std::mutex poolMutex;
+	/** Released buffers by size */
+	std::map<size_t, std::vector<float*>> pool;
+	size_t poolSize = 0;
+};
+
+
+static FftCache& getCache() {
+	// Never destroyed, so transforms destructed after static deinitialization can still release their setups.
+	static FftCache* cache = new FftCache;
+	return *cache;
+}
+
+
+PFFFT_Setup* acquireFftSetup(int length, pffft_transform_t type) {
+	FftCache& cache = getCache();
+	std::lock_guard<std::mutex> lock(cache.setupMutex);
+	auto key = std::make_tuple(length, (int) type);
+	auto it = cache.setups.find(key);
+	if (it != cache.setups.end()) {
+		it->second.refCount++;
+		return it->second.setup;
+	}
+
+	PFFFT_Setup* setup = pffft_new_setup(length, type);
+	if (!setup)
+		return NULL;
+	cache.setups[key] = FftCache::Setup{setup, 1};
+	cache.setupKeys[setup] = key;
+	return setup;
+}
+
+
+void releaseFftSetup(PFFFT_Setup* setup) {
+	if (!setup)
+		return;
+	FftCache& cache = getCache();
+	std::lock_guard<std::mutex> lock(cache.setupMutex);
+	auto keyIt = cache.setupKeys.find(setup);
+	if (keyIt == cache.setupKeys.end())
+		return;
+	auto it = cache.setups.find(keyIt->second);
+	if (--it->second.refCount > 0)
+		return;
+
+	pffft_destroy_setup(setup);
+	cache.setups.erase(it);
+	cache.setupKeys.erase(keyIt);
+}
+
+
+float* acquireFftBuffer(size_t size) {
+	FftCache& cache = getCache();
+	{
+		std::lock_guard<std::mutex> lock(cache.poolMutex);
+		auto it = cache.pool.find(size);
+		if (it != cache.pool.end() && !it->second.empty()) {
+			float* buffer = it->second.back();
+			it->second.pop_back();
+			cache.poolSize -= size;
+			return buffer;
+		}
+	}
+	return (float*) pffft_aligned_malloc(sizeof(float) * size);
+}
+
+
+void releaseFftBuffer(float* buffer, size_t size) {
+	if (!buffer)
+		return;
+	FftCache& cache = getCache();
+	{
+		std::lock_guard<std::mutex> lock(cache.poolMutex);
+		if (cache.poolSize + size <= FftCache_maxPoolSize) {
+			cache.pool[size].push_back(buffer);
+			cache.poolSize += size;
+			return;
+		}
+	}
+	pffft_aligned_free(buffer);
+}
+
+
+} // namespace dsp
+} // namespace rack
@@ -0,0 +1,227 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#if defined ARCH_LIN
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#elif defined ARCH_MAC
+	#include <pthread.h>
+#elif defined ARCH_WIN
+	#include <windows.h>
+#endif
+
+#include <dsp/fir.hpp>
+#include <system.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/** Lowers the priority of the calling thread by `steps`, so threads of shorter partitions preempt it.
+Lowering a thread's priority needs no privileges on any platform.
+*/
+static void lowerThreadPriority(int steps) {
+	if (steps <= 0)
+		return;
+#if defined ARCH_LIN
+	// Linux threads have their own nice value
+	pid_t tid = syscall(SYS_gettid);
+	int nice = getpriority(PRIO_PROCESS, tid);
+	setpriority(PRIO_PROCESS, tid, std::min(nice + 2 * steps, 19));
+#elif defined ARCH_MAC
+	int policy;
+	sched_param param;
+	pthread_getschedparam(pthread_self(), &policy, &param);
+	param.sched_priority = std::max(param.sched_priority - steps, sched_get_priority_min(policy));
+	pthread_setschedparam(pthread_self(), policy, &param);
+#elif defined ARCH_WIN
+	SetThreadPriority(GetCurrentThread(), std::max(THREAD_PRIORITY_NORMAL - steps, THREAD_PRIORITY_LOWEST));
+#endif
+}
+
+
+/** A uniformly partitioned section of the kernel, convolved on its own background thread.
+Each level has its own thread so that the OS preempts a long job of a large partition when a short job of a smaller partition is due.
+*/
+struct PartitionedConvolverLevel {
+	size_t partitionSize;
+	RealTimeConvolver convolver;
+	/** Input and output blocks, alternating between consecutive jobs */
+	float* inputs[2];
+	float* outputs[2];
+	/** Number of jobs submitted. Only accessed by the audio thread. */
+	int64_t submitted = 0;
+	/** Number of jobs completed */
+	std::atomic<int64_t> completed{0};
+
+	std::thread thread;
+	std::mutex mutex;
+	/** Notified when a job is submitted or the thread should stop */
+	std::condition_variable jobCv;
+	/** Notified when a job is completed */
+	std::condition_variable doneCv;
+	/** Number of jobs submitted, published to the thread under `mutex` */
+	int64_t queued = 0;
+	bool stopped = false;
+
+	/** `depth` is the index of the level, by which its thread's priority is lowered. */
+	PartitionedConvolverLevel(size_t partitionSize, const float* kernel, size_t length, int depth) : partitionSize(partitionSize), convolver(partitionSize) {
+		convolver.setKernel(kernel, length);
+		for (int i = 0; i < 2; i++) {
+			inputs[i] = new float[partitionSize];
+			outputs[i] = new float[partitionSize];
+			std::memset(inputs[i], 0, sizeof(float) * partitionSize);
+			std::memset(outputs[i], 0, sizeof(float) * partitionSize);
+		}
+		thread = std::thread(&PartitionedConvolverLevel::run, this, depth);
+	}
+
+	~PartitionedConvolverLevel() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopped = true;
+			jobCv.notify_one();
+		}
+		thread.join();
+		for (int i = 0; i < 2; i++) {
+			delete[] inputs[i];
+			delete[] outputs[i];
+		}
+	}
+
+	void run(int depth) {
+		system::setThreadName("Convolver");
+		lowerThreadPriority(depth);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!stopped) {
+			int64_t index = completed.load(std::memory_order_relaxed);
+			if (index >= queued) {
+				jobCv.wait(lock);
+				continue;
+			}
+			lock.unlock();
+
+			int slot = index % 2;
+			convolver.processBlock(inputs[slot], outputs[slot]);
+			completed.store(index + 1, std::memory_order_release);
+
+			lock.lock();
+			doneCv.notify_all();
+		}
+	}
+
+	/** Called by the audio thread when the input block of the next job is full */
+	void submit() {
+		submitted++;
+		std::lock_guard<std::mutex> lock(mutex);
+		queued = submitted;
+		jobCv.notify_one();
+	}
+
+	/** Waits until job `index` is completed. Returns whether it was late. */
+	bool wait(int64_t index) {
+		if (completed.load(std::memory_order_acquire) > index)
+			return false;
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCv.wait(lock, [&]() {
+			return completed.load(std::memory_order_acquire) > index;
+		});
+		return true;
+	}
+};
+
+
+struct PartitionedConvolver::Internal {
+	size_t blockSize;
+	size_t maxPartitionSize;
+	RealTimeConvolver head;
+	std::vector<PartitionedConvolverLevel*> levels;
+	/** Number of frames processed since the kernel was set */
+	int64_t frame = 0;
+	std::atomic<uint64_t> lateCount{0};
+
+	Internal(size_t blockSize, size_t maxPartitionSize) : blockSize(blockSize), maxPartitionSize(std::max(maxPartitionSize, blockSize)), head(blockSize) {}
+};
+
+
+PartitionedConvolver::PartitionedConvolver(size_t blockSize, size_t maxPartitionSize) {
+	internal = new Internal(blockSize, maxPartitionSize);
+}
+
+PartitionedConvolver::~PartitionedConvolver() {
+	setKernel(NULL, 0);
+	delete internal;
+}
+
+void PartitionedConvolver::setKernel(const float* kernel, size_t length) {
+	// Deleting a level stops its thread
+	for (PartitionedConvolverLevel* level : internal->levels) {
+		delete level;
+	}
+	internal->levels.clear();
+	internal->frame = 0;
+
+	if (!kernel)
+		length = 0;
+
+	// The head covers the kernel up to where the first background partition may start
+	size_t n = std::min(2 * internal->blockSize, internal->maxPartitionSize);
+	size_t headLength = std::min(length, 2 * n);
+	internal->head.setKernel(kernel, headLength);
+
+	// Each level of partition size `n` starts at offset 2n and ends where the next level can start
+	size_t offset = headLength;
+	while (offset < length) {
+		size_t nextN = std::min(2 * n, internal->maxPartitionSize);
+		size_t end = (nextN == n) ? length : std::min(length, 2 * nextN);
+		int depth = internal->levels.size();
+		internal->levels.push_back(new PartitionedConvolverLevel(n, &kernel[offset], end - offset, depth));
+		offset = end;
+		n = nextN;
+	}
+}
+
+void PartitionedConvolver::processBlock(const float* input, float* output) {
+	size_t blockSize = internal->blockSize;
+	internal->head.processBlock(input, output);
+
+	for (PartitionedConvolverLevel* level : internal->levels) {
+		int64_t n = level->partitionSize;
+		int64_t partition = internal->frame / n;
+		size_t offset = internal->frame % n;
+
+		// Add output of the job submitted two partitions ago
+		if (partition >= 2) {
+			int64_t index = partition - 2;
+			if (level->wait(index))
+				internal->lateCount++;
+			const float* levelOutput = &level->outputs[index % 2][offset];
+			for (size_t i = 0; i < blockSize; i++) {
+				output[i] += levelOutput[i];
+			}
+		}
+
+		// Gather input, and submit a job when a partition is full
+		std::memcpy(&level->inputs[partition % 2][offset], input, sizeof(float) * blockSize);
+		if (offset + blockSize == (size_t) n)
+			level->submit();
+	}
+
+	internal->frame += blockSize;
+}
+
+size_t PartitionedConvolver::getBlockSize() {
+	return internal->blockSize;
+}
+
+uint64_t PartitionedConvolver::getLateCount() {
+	return internal->lateCount;
+}
+
+
+} // namespace dsp
+} // namespace rack
@@ -0,0 +1,242 @@
+#if defined ARCH_X64
+	#include <immintrin.h>
+#endif
+
+#include <dsp/kernels.hpp>
+#include <simd/functions.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/*
+Kernels for wider instruction sets are compiled with function target attributes rather than with per-file -m flags.
+This way no inline function from a header can be compiled with instructions the CPU might not support and then be chosen by the linker for the whole library.
+*/
+#if defined ARCH_X64
+	#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+
+// Baseline
+
+static void copyFinite_baseline(const float* in, float* out, int len) {
+	int i = 0;
+	for (; i + 4 <= len; i += 4) {
+		simd::float_4 x = simd::float_4::load(&in[i]);
+		x &= (simd::fabs(x) < INFINITY);
+		x.store(&out[i]);
+	}
+	for (; i < len; i++) {
+		float x = in[i];
+		out[i] = std::isfinite(x) ? x : 0.f;
+	}
+}
+
+static void fftConvolveAccumulate_baseline(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale) {
+	pffft_zconvolve_accumulate(setup, a, b, ab, scale);
+}
+
+
+#if defined ARCH_X64
+
+/*
+With 4-wide SIMD, PFFFT's unordered real spectrum is a sequence of blocks of 8 floats, 4 real parts followed by their 4 imaginary parts.
+The first block's element 0 holds the real DC and Nyquist bins instead of a complex bin.
+*/
+
+/** Wide FFT kernels depend on PFFFT's SIMD layout. */
+static bool fftLayoutSupported() {
+	return pffft_simd_size() == 4;
+}
+
+
+// AVX2
+
+TARGET_AVX2
+static void copyFinite_avx2(const float* in, float* out, int len) {
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 inf = _mm256_set1_ps(INFINITY);
+	int i = 0;
+	for (; i + 8 <= len; i += 8) {
+		__m256 x = _mm256_loadu_ps(&in[i]);
+		__m256 finite = _mm256_cmp_ps(_mm256_and_ps(x, absMask), inf, _CMP_LT_OQ);
+		_mm256_storeu_ps(&out[i], _mm256_and_ps(x, finite));
+	}
+	for (; i < len; i++) {
+		float x = in[i];
+		out[i] = std::isfinite(x) ? x : 0.f;
+	}
+}
+
+TARGET_AVX2
+static void fftConvolveAccumulate_avx2(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale) {
+	if (!fftLayoutSupported()) {
+		pffft_zconvolve_accumulate(setup, a, b, ab, scale);
+		return;
+	}
+	// DC and Nyquist bins
+	float dc = ab[0] + a[0] * b[0] * scale;
+	float nyquist = ab[4] + a[4] * b[4] * scale;
+
+	const __m256 s = _mm256_set1_ps(scale);
+	// Two blocks per iteration
+	for (int i = 0; i < length; i += 16) {
+		__m256 a0 = _mm256_loadu_ps(&a[i]);
+		__m256 a1 = _mm256_loadu_ps(&a[i + 8]);
+		__m256 b0 = _mm256_loadu_ps(&b[i]);
+		__m256 b1 = _mm256_loadu_ps(&b[i + 8]);
+		__m256 ab0 = _mm256_loadu_ps(&ab[i]);
+		__m256 ab1 = _mm256_loadu_ps(&ab[i + 8]);
+		// Gather real and imaginary parts of both blocks
+		__m256 ar = _mm256_permute2f128_ps(a0, a1, 0x20);
+		__m256 ai = _mm256_permute2f128_ps(a0, a1, 0x31);
+		__m256 br = _mm256_permute2f128_ps(b0, b1, 0x20);
+		__m256 bi = _mm256_permute2f128_ps(b0, b1, 0x31);
+		__m256 abr = _mm256_permute2f128_ps(ab0, ab1, 0x20);
+		__m256 abi = _mm256_permute2f128_ps(ab0, ab1, 0x31);
+		// Complex multiply-accumulate
+		__m256 pr = _mm256_fmsub_ps(ar, br, _mm256_mul_ps(ai, bi));
+		__m256 pi = _mm256_fmadd_ps(ar, bi, _mm256_mul_ps(ai, br));
+		abr = _mm256_fmadd_ps(pr, s, abr);
+		abi = _mm256_fmadd_ps(pi, s, abi);
+		_mm256_storeu_ps(&ab[i], _mm256_permute2f128_ps(abr, abi, 0x20));
+		_mm256_storeu_ps(&ab[i + 8], _mm256_permute2f128_ps(abr, abi, 0x31));
+	}
+
+	ab[0] = dc;
+	ab[4] = nyquist;
+}
+
+
+// AVX-512
+
+TARGET_AVX512
+static void copyFinite_avx512(const float* in, float* out, int len) {
+	const __m512 inf = _mm512_set1_ps(INFINITY);
+	const __m512i absMask = _mm512_set1_epi32(0x7fffffff);
+	for (int i = 0; i < len; i += 16) {
+		// Mask off elements past the end, so a full polyphonic cable is a single iteration
+		__mmask16 k = (len - i >= 16) ? 0xffff : (__mmask16) ((1 << (len - i)) - 1);
+		__m512 x = _mm512_maskz_loadu_ps(k, &in[i]);
+		__m512 absX = _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), absMask));
+		__mmask16 finite = _mm512_cmp_ps_mask(absX, inf, _CMP_LT_OQ);
+		_mm512_mask_storeu_ps(&out[i], k, _mm512_maskz_mov_ps(finite, x));
+	}
+}
+
+TARGET_AVX512
+static void fftConvolveAccumulate_avx512(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale) {
+	if (!fftLayoutSupported()) {
+		pffft_zconvolve_accumulate(setup, a, b, ab, scale);
+		return;
+	}
+	float dc = ab[0] + a[0] * b[0] * scale;
+	float nyquist = ab[4] + a[4] * b[4] * scale;
+
+	const __m512 s = _mm512_set1_ps(scale);
+	// Indices of the real and imaginary parts of four blocks in two vectors
+	const __m512i realIndex = _mm512_setr_epi32(0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27);
+	const __m512i imagIndex = _mm512_setr_epi32(4, 5, 6, 7, 12, 13, 14, 15, 20, 21, 22, 23, 28, 29, 30, 31);
+	// Inverse permutation, interleaving real and imaginary parts back into blocks
+	const __m512i lowIndex = _mm512_setr_epi32(0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23);
+	const __m512i highIndex = _mm512_setr_epi32(8, 9, 10, 11, 24, 25, 26, 27, 12, 13, 14, 15, 28, 29, 30, 31);
+	// Four blocks per iteration. Real PFFFT lengths are multiples of 32.
+	for (int i = 0; i < length; i += 32) {
+		__m512 a0 = _mm512_loadu_ps(&a[i]);
+		__m512 a1 = _mm512_loadu_ps(&a[i + 16]);
+		__m512 b0 = _mm512_loadu_ps(&b[i]);
+		__m512 b1 = _mm512_loadu_ps(&b[i + 16]);
+		__m512 ab0 = _mm512_loadu_ps(&ab[i]);
+		__m512 ab1 = _mm512_loadu_ps(&ab[i + 16]);
+		__m512 ar = _mm512_permutex2var_ps(a0, realIndex, a1);
+		__m512 ai = _mm512_permutex2var_ps(a0, imagIndex, a1);
+		__m512 br = _mm512_permutex2var_ps(b0, realIndex, b1);
+		__m512 bi = _mm512_permutex2var_ps(b0, imagIndex, b1);
+		__m512 abr = _mm512_permutex2var_ps(ab0, realIndex, ab1);
+		__m512 abi = _mm512_permutex2var_ps(ab0, imagIndex, ab1);
+		__m512 pr = _mm512_fmsub_ps(ar, br, _mm512_mul_ps(ai, bi));
+		__m512 pi = _mm512_fmadd_ps(ar, bi, _mm512_mul_ps(ai, br));
+		abr = _mm512_fmadd_ps(pr, s, abr);
+		abi = _mm512_fmadd_ps(pi, s, abi);
+		_mm512_storeu_ps(&ab[i], _mm512_permutex2var_ps(abr, lowIndex, abi));
+		_mm512_storeu_ps(&ab[i + 16], _mm512_permutex2var_ps(abr, highIndex, abi));
+	}
+
+	ab[0] = dc;
+	ab[4] = nyquist;
+}
+
+#endif // ARCH_X64
+
+
+// Dispatch
+
+struct Kernels {
+	void (*copyFinite)(const float* in, float* out, int len);
+	void (*fftConvolveAccumulate)(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale);
+};
+
+static const Kernels kernelsTable[CPU_LEVELS_LEN] = {
+	{copyFinite_baseline, fftConvolveAccumulate_baseline},
+#if defined ARCH_X64
+	{copyFinite_avx2, fftConvolveAccumulate_avx2},
+	{copyFinite_avx512, fftConvolveAccumulate_avx512},
+#else
+	{copyFinite_baseline, fftConvolveAccumulate_baseline},
+	{copyFinite_baseline, fftConvolveAccumulate_baseline},
+#endif
+};
+
+
+CpuLevel getCpuLevelSupported() {
+#if defined ARCH_X64
+	// Might be called by a static initializer before the compiler runtime has initialized its CPU model
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return CPU_LEVEL_AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return CPU_LEVEL_AVX2;
+#endif
+	return CPU_LEVEL_BASELINE;
+}
+
+
+/** Static storage is zero-initialized before any dynamic initialization, so kernels called by other static initializers use the baseline. */
+static CpuLevel cpuLevel = getCpuLevelSupported();
+
+
+CpuLevel getCpuLevel() {
+	return cpuLevel;
+}
+
+
+void setCpuLevel(CpuLevel level) {
+	cpuLevel = std::min(level, getCpuLevelSupported());
+}
+
+
+std::string getCpuLevelName(CpuLevel level) {
+	switch (level) {
+		case CPU_LEVEL_BASELINE: return "Baseline";
+		case CPU_LEVEL_AVX2: return "AVX2";
+		case CPU_LEVEL_AVX512: return "AVX-512";
+		default: return "";
+	}
+}
+
+
+void copyFinite(const float* in, float* out, int len) {
+	kernelsTable[cpuLevel].copyFinite(in, out, len);
+}
+
+
+void fftConvolveAccumulate(PFFFT_Setup* setup, int length, const float* a, const float* b, float* ab, float scale) {
+	kernelsTable[cpuLevel].fftConvolveAccumulate(setup, length, a, b, ab, scale);
+}
+
+
+} // namespace dsp
+} // namespace rack
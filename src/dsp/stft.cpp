@@ -0,0 +1,346 @@
+#include <thread>
+#include <atomic>
+#include <climits>
+#if defined ARCH_MAC
+	#include <dispatch/dispatch.h>
+#elif defined ARCH_WIN
+	#include <windows.h>
+#else
+	#include <semaphore.h>
+	#include <cerrno>
+#endif
+
+#include <dsp/stft.hpp>
+#include <dsp/window.hpp>
+#include <system.hpp>
+
+
+namespace rack {
+namespace dsp {
+
+
+/** Counting semaphore whose post() wakes a waiting thread without taking a lock, so the audio thread can call it.
+*/
+struct StftSemaphore {
+#if defined ARCH_MAC
+	dispatch_semaphore_t sem;
+	StftSemaphore() {
+		sem = dispatch_semaphore_create(0);
+	}
+	~StftSemaphore() {
+		dispatch_release(sem);
+	}
+	void post() {
+		dispatch_semaphore_signal(sem);
+	}
+	void wait() {
+		dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
+	}
+#elif defined ARCH_WIN
+	HANDLE sem;
+	StftSemaphore() {
+		sem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+	}
+	~StftSemaphore() {
+		CloseHandle(sem);
+	}
+	void post() {
+		ReleaseSemaphore(sem, 1, NULL);
+	}
+	void wait() {
+		WaitForSingleObject(sem, INFINITE);
+	}
+#else
+	sem_t sem;
+	StftSemaphore() {
+		sem_init(&sem, 0, 0);
+	}
+	~StftSemaphore() {
+		sem_destroy(&sem);
+	}
+	void post() {
+		sem_post(&sem);
+	}
+	void wait() {
+		while (sem_wait(&sem) != 0 && errno == EINTR) {}
+	}
+#endif
+};
+
+
+/** A frame in flight between the audio thread and the helper thread */
+struct StftSlot {
+	/** Raw input frame, replaced by the windowed output frame */
+	float* frame;
+	float* spectrum;
+};
+
+
+struct Stft::Internal {
+	int fftSize;
+	int hopSize;
+	bool async;
+	RealFFT fft;
+	Processor processor;
+
+	float* window;
+	/** Reciprocal of the overlapping squared windows and FFT scale, for each frame of a hop */
+	float* norm;
+	/** Last `fftSize` input frames, with the current hop being written to the end */
+	float* inputBuffer;
+	/** Overlap-added output frames, starting at the next hop to be emitted */
+	float* outputBuffer;
+	/** Normalized output frames emitted during the current hop */
+	float* outputHop;
+	int hopPos = 0;
+	StftSlot slots[2];
+	/** Number of frames handed to processFrame(). Only accessed by the audio thread. */
+	int64_t submitted = 0;
+	/** Frames before this index were submitted before the last reset(), so their output is discarded. Only accessed by the audio thread. */
+	int64_t discarded = 0;
+	/** Number of frames submitted, published to the helper thread */
+	std::atomic<int64_t> submittedShared{0};
+	/** Number of frames completed by processFrame() */
+	std::atomic<int64_t> completed{0};
+	std::atomic<uint64_t> lateCount{0};
+	/** Set while processBlock() runs, to catch settings changed concurrently */
+	std::atomic<bool> processing{false};
+
+	std::thread thread;
+	std::atomic<bool> stopped{true};
+	/** Posted when a frame is submitted or the thread should stop */
+	StftSemaphore frameSemaphore;
+	/** Set by the audio thread before it waits for a frame, and taken by whichever thread clears it first */
+	std::atomic<bool> waiting{false};
+	/** Posted when a frame is completed and the helper thread took `waiting`, so every post has exactly one wait */
+	StftSemaphore doneSemaphore;
+
+	Internal(int fftSize, int hopSize, bool async) : fftSize(fftSize), hopSize(hopSize), async(async), fft(fftSize) {
+		window = new float[fftSize];
+		norm = new float[hopSize];
+		inputBuffer = new float[fftSize];
+		outputBuffer = new float[fftSize];
+		outputHop = new float[hopSize];
+		for (int i = 0; i < 2; i++) {
+			slots[i].frame = acquireFftBuffer(fftSize);
+			slots[i].spectrum = acquireFftBuffer(fftSize);
+		}
+		// Periodic Hann window, which overlaps to a constant for any hop of at most fftSize / 2
+		for (int i = 0; i < fftSize; i++) {
+			window[i] = hann(float(i) / fftSize);
+		}
+		updateNorm();
+		clear();
+	}
+
+	~Internal() {
+		for (int i = 0; i < 2; i++) {
+			releaseFftBuffer(slots[i].frame, fftSize);
+			releaseFftBuffer(slots[i].spectrum, fftSize);
+		}
+		delete[] window;
+		delete[] norm;
+		delete[] inputBuffer;
+		delete[] outputBuffer;
+		delete[] outputHop;
+	}
+
+	void updateNorm() {
+		for (int i = 0; i < hopSize; i++) {
+			float sum = 0.f;
+			for (int j = i; j < fftSize; j += hopSize) {
+				sum += window[j] * window[j];
+			}
+			// irfft(rfft(x)) = fftSize * x
+			norm[i] = (sum > 0.f) ? 1.f / (sum * fftSize) : 0.f;
+		}
+	}
+
+	void clear() {
+		std::memset(inputBuffer, 0, sizeof(float) * fftSize);
+		std::memset(outputBuffer, 0, sizeof(float) * fftSize);
+		std::memset(outputHop, 0, sizeof(float) * hopSize);
+		hopPos = 0;
+	}
+
+	void startThread() {
+		if (!async)
+			return;
+		stopped = false;
+		thread = std::thread(&Internal::run, this);
+	}
+
+	/** Must not run concurrently with processHop(), since it finishes the frames in flight on the caller's thread. */
+	void stopThread() {
+		stopped = true;
+		frameSemaphore.post();
+		if (thread.joinable())
+			thread.join();
+		// Finish frames in flight on this thread
+		for (int64_t index = completed; index < submitted; index++) {
+			processFrame(slots[index % 2]);
+		}
+		completed.store(submitted);
+	}
+
+	void run() {
+		system::setThreadName("STFT");
+		while (!stopped) {
+			int64_t index = completed.load(std::memory_order_relaxed);
+			if (index >= submittedShared.load(std::memory_order_acquire)) {
+				// Posts can outnumber waits, so the loop rechecks after each wakeup.
+				frameSemaphore.wait();
+				continue;
+			}
+			processFrame(slots[index % 2]);
+			completed.store(index + 1);
+			if (waiting.exchange(false))
+				doneSemaphore.post();
+		}
+	}
+
+	void processFrame(StftSlot& slot) {
+		for (int i = 0; i < fftSize; i++) {
+			slot.frame[i] *= window[i];
+		}
+		fft.rfft(slot.frame, slot.spectrum);
+		if (processor)
+			processor(slot.spectrum);
+		fft.irfft(slot.spectrum, slot.frame);
+		for (int i = 0; i < fftSize; i++) {
+			slot.frame[i] *= window[i];
+		}
+	}
+
+	void waitForFrame(int64_t index) {
+		if (completed.load(std::memory_order_acquire) > index)
+			return;
+		lateCount++;
+		while (true) {
+			// Sequentially consistent, so either the helper thread sees `waiting` after completing the frame, or this thread sees the completed frame.
+			waiting.store(true);
+			if (completed.load() > index) {
+				// If the helper thread took `waiting`, consume its post
+				if (!waiting.exchange(false))
+					doneSemaphore.wait();
+				return;
+			}
+			doneSemaphore.wait();
+		}
+	}
+
+	void overlapAdd(const float* frame) {
+		for (int i = 0; i < fftSize; i++) {
+			outputBuffer[i] += frame[i];
+		}
+	}
+
+	/** Called when the input buffer has been filled with a new hop */
+	void processHop() {
+		int64_t index = submitted++;
+		StftSlot& slot = slots[index % 2];
+		std::memcpy(slot.frame, inputBuffer, sizeof(float) * fftSize);
+
+		if (async) {
+			// Hand off the frame, and collect the previous one, which has had one hop to complete
+			submittedShared.store(submitted, std::memory_order_release);
+			frameSemaphore.post();
+			if (index >= 1) {
+				waitForFrame(index - 1);
+				if (index - 1 >= discarded)
+					overlapAdd(slots[(index - 1) % 2].frame);
+			}
+		}
+		else {
+			processFrame(slot);
+			completed.store(submitted);
+			overlapAdd(slot.frame);
+		}
+
+		// The first hop of the output buffer has received all its overlapping frames
+		for (int i = 0; i < hopSize; i++) {
+			outputHop[i] = outputBuffer[i] * norm[i];
+		}
+		std::memmove(outputBuffer, &outputBuffer[hopSize], sizeof(float) * (fftSize - hopSize));
+		std::memset(&outputBuffer[fftSize - hopSize], 0, sizeof(float) * hopSize);
+		std::memmove(inputBuffer, &inputBuffer[hopSize], sizeof(float) * (fftSize - hopSize));
+	}
+};
+
+
+Stft::Stft(int fftSize, int hopSize, bool async) {
+	// RealFFT requires a multiple of 32
+	assert(fftSize > 0 && fftSize % 32 == 0);
+	assert(hopSize > 0 && fftSize % hopSize == 0);
+	internal = new Internal(fftSize, hopSize, async);
+	internal->startThread();
+}
+
+Stft::~Stft() {
+	internal->stopThread();
+	delete internal;
+}
+
+void Stft::setWindow(const float* window) {
+	assert(!internal->processing.load());
+	internal->stopThread();
+	std::memcpy(internal->window, window, sizeof(float) * internal->fftSize);
+	internal->updateNorm();
+	internal->startThread();
+}
+
+void Stft::setProcessor(Processor processor) {
+	assert(!internal->processing.load());
+	internal->stopThread();
+	internal->processor = processor;
+	internal->startThread();
+}
+
+void Stft::reset() {
+	if (internal->async && internal->submitted > 0)
+		internal->waitForFrame(internal->submitted - 1);
+	// Don't overlap-add the frame in flight, which was taken from the old input
+	internal->discarded = internal->submitted;
+	internal->clear();
+}
+
+void Stft::processBlock(const float* input, float* output, int frames) {
+	int fftSize = internal->fftSize;
+	int hopSize = internal->hopSize;
+	internal->processing.store(true, std::memory_order_relaxed);
+	while (frames > 0) {
+		int hopPos = internal->hopPos;
+		int n = std::min(frames, hopSize - hopPos);
+		std::memcpy(&internal->inputBuffer[fftSize - hopSize + hopPos], input, sizeof(float) * n);
+		std::memcpy(output, &internal->outputHop[hopPos], sizeof(float) * n);
+		internal->hopPos += n;
+		if (internal->hopPos == hopSize) {
+			internal->hopPos = 0;
+			internal->processHop();
+		}
+		input += n;
+		output += n;
+		frames -= n;
+	}
+	internal->processing.store(false, std::memory_order_relaxed);
+}
+
+int Stft::getFftSize() {
+	return internal->fftSize;
+}
+
+int Stft::getHopSize() {
+	return internal->hopSize;
+}
+
+int Stft::getLatency() {
+	return internal->fftSize + (internal->async ? internal->hopSize : 0);
+}
+
+uint64_t Stft::getLateCount() {
+	return internal->lateCount;
+}
+
+
+} // namespace dsp
+} // namespace rack
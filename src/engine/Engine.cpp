@@ -5,6 +5,7 @@
 #include <mutex>
 #include <atomic>
 #include <tuple>
+#include <unordered_map>
 #if defined ARCH_X64
 	#include <pmmintrin.h>
 #endif
@@ -17,12 +18,17 @@
 #include <patch.hpp>
 #include <plugin.hpp>
 #include <mutex.hpp>
+#include <dsp/kernels.hpp>
+#include <dsp/ringbuffer.hpp>
 
 
 namespace rack {
 namespace engine {
 
 
+static const int PORT_DIVIDER = 7;
+
+
 #if defined ARCH_X64
 static void initMXCSR() {
 	// Set CPU to flush-to-zero (FTZ) and denormals-are-zero (DAZ) mode
@@ -186,6 +192,30 @@ struct EngineWorker {
 };
 
 
+/** Port statistics of a cable, accumulated by the engine between published blocks */
+struct PortAccumulator {
+	float sum = 0.f;
+	float sumSquares = 0.f;
+	int count = 0;
+};
+
+
+/** Brightness of every module light, copied by the engine for the UI thread */
+struct LightSnapshot {
+	struct Entry {
+		int64_t moduleId;
+		/** Index of the module's first light in `brightnesses` */
+		size_t offset;
+		int lightsLen;
+	};
+	/** In the order of Engine::Internal::modules */
+	std::vector<Entry> entries;
+	std::vector<float> brightnesses;
+	/** Value of Engine::Internal::lightLayout when the snapshot was taken */
+	int64_t layout = -1;
+};
+
+
 struct Engine::Internal {
 	std::vector<Module*> modules;
 	std::vector<Cable*> cables;
@@ -215,6 +245,29 @@ struct Engine::Internal {
 	double meterLastAverage = 0.0;
 	double meterLastMax = 0.0;
 
+	// Port summaries
+	/** In the order of `cables` */
+	std::vector<PortAccumulator> portAccumulators;
+	/** Number of frames accumulated since the last published block */
+	int portAccumulatorFrames = 0;
+	dsp::TripleBuffer<std::vector<PortSummary>> portSummaries;
+	/** Cable ID -> index in the UI thread's read() snapshot */
+	std::unordered_map<int64_t, size_t> portSummaryIndexes;
+
+	// Light snapshot
+	/** Set by the UI thread, taken by the engine at the start of a block */
+	std::atomic<bool> lightSnapshotRequested{false};
+	bool lightSnapshotPending = false;
+	/** Whether the current frame is the last one before a light snapshot */
+	bool lightFrame = false;
+	int64_t lastLightFrame = 0;
+	/** Incremented when modules are added or removed, so the UI thread knows when to rebuild its index */
+	int64_t lightLayout = 0;
+	dsp::TripleBuffer<LightSnapshot> lightSnapshots;
+	/** Module ID -> index in the UI thread's read() snapshot entries */
+	std::unordered_map<int64_t, size_t> lightSnapshotIndexes;
+	int64_t lightSnapshotIndexesLayout = -1;
+
 	// Parameter smoothing
 	Module* smoothModule = NULL;
 	int smoothParamId = 0;
@@ -318,6 +371,8 @@ static void Engine_stepWorker(Engine* that, int threadId) {
 	processArgs.sampleRate = internal->sampleRate;
 	processArgs.sampleTime = internal->sampleTime;
 	processArgs.frame = internal->frame;
+	processArgs.lightFrame = internal->lightFrame;
+	processArgs.lightTime = (internal->frame + 1 - internal->lastLightFrame) * internal->sampleTime;
 
 	// Step each module
 	while (true) {
@@ -338,14 +393,8 @@ static void Cable_step(Cable* that) {
 	Input* input = &that->inputModule->inputs[that->inputId];
 	// Match number of polyphonic channels to output port
 	int channels = output->channels;
-	// Copy all voltages from output to input
-	for (int c = 0; c < channels; c++) {
-		float v = output->voltages[c];
-		// Set 0V if infinite or NaN
-		if (!std::isfinite(v))
-			v = 0.f;
-		input->voltages[c] = v;
-	}
+	// Copy all voltages from output to input, setting 0V if infinite or NaN
+	dsp::copyFinite(output->voltages, input->voltages, channels);
 	// Set higher channel voltages to 0
 	for (int c = channels; c < input->channels; c++) {
 		input->voltages[c] = 0.f;
@@ -354,6 +403,19 @@ static void Cable_step(Cable* that) {
 }
 
 
+static void Cable_accumulate(Cable* that, PortAccumulator* acc) {
+	Input* input = &that->inputModule->inputs[that->inputId];
+	float sumSquares = 0.f;
+	for (int c = 0; c < input->channels; c++) {
+		float v = input->voltages[c];
+		sumSquares += v * v;
+	}
+	acc->sum += input->voltages[0];
+	acc->sumSquares += sumSquares;
+	acc->count++;
+}
+
+
 /** Steps a single frame
 */
 static void Engine_stepFrame(Engine* that) {
@@ -385,6 +447,15 @@ static void Engine_stepFrame(Engine* that) {
 		Cable_step(cable);
 	}
 
+	// Accumulate port summaries for plug lights
+	if (internal->frame % PORT_DIVIDER == 0) {
+		size_t cablesLen = internal->cables.size();
+		for (size_t i = 0; i < cablesLen; i++) {
+			Cable_accumulate(internal->cables[i], &internal->portAccumulators[i]);
+		}
+		internal->portAccumulatorFrames++;
+	}
+
 	// Flip messages for each module
 	for (Module* module : that->internal->modules) {
 		if (module->leftExpander.messageFlipRequested) {
@@ -407,6 +478,71 @@ static void Engine_stepFrame(Engine* that) {
 }
 
 
+/** Publishes the port summaries accumulated during the block to the UI thread.
+*/
+static void Engine_publishPortSummaries(Engine* that) {
+	Engine::Internal* internal = that->internal;
+	// Keep accumulating if the block was shorter than the divider
+	if (internal->portAccumulatorFrames == 0)
+		return;
+
+	size_t cablesLen = internal->cables.size();
+	std::vector<PortSummary>& summaries = internal->portSummaries.write();
+	// Only allocates when cables were added since this buffer was last written
+	summaries.resize(cablesLen);
+	for (size_t i = 0; i < cablesLen; i++) {
+		Cable* cable = internal->cables[i];
+		PortAccumulator& acc = internal->portAccumulators[i];
+		PortSummary& summary = summaries[i];
+		summary.cableId = cable->id;
+		summary.channels = cable->inputModule->inputs[cable->inputId].channels;
+		if (acc.count > 0 && summary.channels > 0) {
+			summary.mean = acc.sum / acc.count;
+			summary.rms = std::sqrt(acc.sumSquares / acc.count);
+		}
+		else {
+			summary.mean = 0.f;
+			summary.rms = 0.f;
+		}
+		acc = PortAccumulator();
+	}
+	internal->portSummaries.publish();
+	internal->portAccumulatorFrames = 0;
+}
+
+
+/** Copies the lights of all modules to the UI thread.
+*/
+static void Engine_publishLights(Engine* that) {
+	Engine::Internal* internal = that->internal;
+	// Light is a single float, so a module's lights can be copied with one memcpy().
+	static_assert(sizeof(Light) == sizeof(float), "");
+
+	LightSnapshot& snapshot = internal->lightSnapshots.write();
+	size_t modulesLen = internal->modules.size();
+	// Only allocates when modules were added since this buffer was last written
+	snapshot.entries.resize(modulesLen);
+	size_t offset = 0;
+	for (size_t i = 0; i < modulesLen; i++) {
+		Module* module = internal->modules[i];
+		LightSnapshot::Entry& entry = snapshot.entries[i];
+		entry.moduleId = module->id;
+		entry.offset = offset;
+		entry.lightsLen = module->lights.size();
+		offset += entry.lightsLen;
+	}
+	snapshot.brightnesses.resize(offset);
+	for (size_t i = 0; i < modulesLen; i++) {
+		const LightSnapshot::Entry& entry = snapshot.entries[i];
+		if (entry.lightsLen > 0)
+			std::memcpy(&snapshot.brightnesses[entry.offset], internal->modules[i]->lights.data(), sizeof(float) * entry.lightsLen);
+	}
+	snapshot.layout = internal->lightLayout;
+	internal->lightSnapshots.publish();
+	internal->lastLightFrame = internal->frame;
+}
+
+
 static void Port_setDisconnected(Port* that) {
 	that->channels = 0;
 	for (int c = 0; c < PORT_MAX_CHANNELS; c++) {
@@ -556,13 +692,22 @@ void Engine::stepBlock(int frames) {
 	// Launch workers
 	Engine_relaunchWorkers(this, settings::threadCount);
 
+	// Snapshot lights at the end of this block if the UI thread asked for one
+	internal->lightSnapshotPending = internal->lightSnapshotRequested.exchange(false);
+
 	// Step individual frames
 	for (int i = 0; i < frames; i++) {
+		internal->lightFrame = internal->lightSnapshotPending && (i == frames - 1);
 		Engine_stepFrame(this);
 	}
+	internal->lightFrame = false;
 
 	yieldWorkers();
 
+	Engine_publishPortSummaries(this);
+	if (internal->lightSnapshotPending)
+		Engine_publishLights(this);
+
 	internal->block++;
 
 	// Stop timer
@@ -757,6 +902,7 @@ void Engine::addModule(Module* module) {
 	// Add module
 	internal->modules.push_back(module);
 	internal->modulesCache[module->id] = module;
+	internal->lightLayout++;
 	// Dispatch AddEvent
 	Module::AddEvent eAdd;
 	module->onAdd(eAdd);
@@ -819,6 +965,7 @@ void Engine::removeModule_NoLock(Module* module) {
 	// Remove module
 	internal->modulesCache.erase(module->id);
 	internal->modules.erase(it);
+	internal->lightLayout++;
 	// Reset expanders
 	module->leftExpander.moduleId = -1;
 	module->leftExpander.module = NULL;
@@ -975,6 +1122,7 @@ void Engine::addCable(Cable* cable) {
 	}
 	// Add the cable
 	internal->cables.push_back(cable);
+	internal->portAccumulators.push_back(PortAccumulator());
 	internal->cablesCache[cable->id] = cable;
 	Engine_updateConnected(this);
 	// Dispatch input port event
@@ -1009,6 +1157,7 @@ void Engine::removeCable_NoLock(Cable* cable) {
 	assert(it != internal->cables.end());
 	// Remove the cable
 	internal->cablesCache.erase(cable->id);
+	internal->portAccumulators.erase(internal->portAccumulators.begin() + (it - internal->cables.begin()));
 	internal->cables.erase(it);
 	Engine_updateConnected(this);
 	bool outputIsConnected = false;
@@ -1054,6 +1203,53 @@ Cable* Engine::getCable(int64_t cableId) {
 }
 
 
+void Engine::updatePortSummaries() {
+	if (!internal->portSummaries.update())
+		return;
+	const std::vector<PortSummary>& summaries = internal->portSummaries.read();
+	internal->portSummaryIndexes.clear();
+	for (size_t i = 0; i < summaries.size(); i++) {
+		internal->portSummaryIndexes[summaries[i].cableId] = i;
+	}
+}
+
+
+const PortSummary* Engine::getPortSummary(int64_t cableId) {
+	auto it = internal->portSummaryIndexes.find(cableId);
+	if (it == internal->portSummaryIndexes.end())
+		return NULL;
+	return &internal->portSummaries.read()[it->second];
+}
+
+
+void Engine::updateLightSnapshot() {
+	internal->lightSnapshotRequested = true;
+	if (!internal->lightSnapshots.update())
+		return;
+	const LightSnapshot& snapshot = internal->lightSnapshots.read();
+	if (snapshot.layout == internal->lightSnapshotIndexesLayout)
+		return;
+	// Modules were added or removed, so rebuild the index
+	internal->lightSnapshotIndexes.clear();
+	for (size_t i = 0; i < snapshot.entries.size(); i++) {
+		internal->lightSnapshotIndexes[snapshot.entries[i].moduleId] = i;
+	}
+	internal->lightSnapshotIndexesLayout = snapshot.layout;
+}
+
+
+const float* Engine::getLightSnapshot(int64_t moduleId, int* lightsLen) {
+	auto it = internal->lightSnapshotIndexes.find(moduleId);
+	if (it == internal->lightSnapshotIndexes.end())
+		return NULL;
+	const LightSnapshot& snapshot = internal->lightSnapshots.read();
+	const LightSnapshot::Entry& entry = snapshot.entries[it->second];
+	if (lightsLen)
+		*lightsLen = entry.lightsLen;
+	return snapshot.brightnesses.data() + entry.offset;
+}
+
+
 void Engine::setParamValue(Module* module, int paramId, float value) {
 	// If param is being smoothed, cancel smoothing.
 	if (internal->smoothModule == module && internal->smoothParamId == paramId) {
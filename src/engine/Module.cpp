@@ -12,7 +12,6 @@ namespace rack {
 namespace engine {
 
 
-static const int PORT_DIVIDER = 7;
 // Arbitrary prime number so it doesn't over- or under-estimate time of buffered processors.
 static const int METER_DIVIDER = 37;
 static const int METER_BUFFER_LEN = 32;
@@ -308,28 +307,6 @@ int Module::meterIndex() {
 }
 
 
-static void Port_step(Port* that, float deltaTime) {
-	// Set plug lights
-	if (that->channels == 0) {
-		that->plugLights[0].setBrightness(0.f);
-		that->plugLights[1].setBrightness(0.f);
-		that->plugLights[2].setBrightness(0.f);
-	}
-	else if (that->channels == 1) {
-		float v = that->getVoltage() / 10.f;
-		that->plugLights[0].setSmoothBrightness(-v, deltaTime);
-		that->plugLights[1].setSmoothBrightness(v, deltaTime);
-		that->plugLights[2].setBrightness(0.f);
-	}
-	else {
-		float v = that->getVoltageRMS() / 10.f;
-		that->plugLights[0].setBrightness(0.f);
-		that->plugLights[1].setBrightness(0.f);
-		that->plugLights[2].setSmoothBrightness(v, deltaTime);
-	}
-}
-
-
 void Module::doProcess(const ProcessArgs& args) {
 	// This global setting can change while the function is running, so use a local variable.
 	bool meterEnabled = settings::cpuMeter && (args.frame % METER_DIVIDER == 0);
@@ -371,17 +348,6 @@ void Module::doProcess(const ProcessArgs& args) {
 			internal->meterDurationTotal = 0.f;
 		}
 	}
-
-	// Iterate ports to step plug lights
-	if (args.frame % PORT_DIVIDER == 0) {
-		float portTime = args.sampleTime * PORT_DIVIDER;
-		for (Input& input : inputs) {
-			Port_step(&input, portTime);
-		}
-		for (Output& output : outputs) {
-			Port_step(&output, portTime);
-		}
-	}
 }
 
 
@@ -460,6 +460,24 @@ void Output::sendMessage(const Message& message) {
 	}
 }
 
+size_t Output::getQueueSize() {
+	if (!outputDevice)
+		return 0;
+	return outputDevice->getQueueSize();
+}
+
+uint64_t Output::getDroppedCount() {
+	if (!outputDevice)
+		return 0;
+	return outputDevice->getDroppedCount();
+}
+
+uint64_t Output::getCoalescedCount() {
+	if (!outputDevice)
+		return 0;
+	return outputDevice->getCoalescedCount();
+}
+
 
 ////////////////////
 // midi
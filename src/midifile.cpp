@@ -0,0 +1,541 @@
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include <midifile.hpp>
+#include <asset.hpp>
+#include <system.hpp>
+#include <string.hpp>
+#include <context.hpp>
+#include <engine/Engine.hpp>
+
+
+namespace rack {
+namespace midifile {
+
+
+static const int DRIVER_ID = -13;
+static const size_t NUM_RECORDERS = 4;
+/** Duration in seconds that Input messages are pushed ahead of the Engine frame. */
+static const double LOOKAHEAD = 0.1;
+
+
+static std::string getDir() {
+	return asset::user("midi");
+}
+
+
+////////////////////
+// Standard MIDI File reading
+////////////////////
+
+struct Event {
+	/** Time in seconds since the start of the file */
+	double time;
+	midi::Message message;
+};
+
+struct Reader {
+	const uint8_t* data;
+	size_t size;
+	size_t pos = 0;
+
+	Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	void require(size_t n) {
+		if (pos + n > size)
+			throw Exception("Unexpected end of MIDI file");
+	}
+	uint8_t u8() {
+		require(1);
+		return data[pos++];
+	}
+	uint32_t u16() {
+		uint32_t x = u8() << 8;
+		return x | u8();
+	}
+	uint32_t u32() {
+		uint32_t x = u16() << 16;
+		return x | u16();
+	}
+	uint32_t vlq() {
+		uint32_t x = 0;
+		for (int i = 0; i < 4; i++) {
+			uint8_t b = u8();
+			x = (x << 7) | (b & 0x7f);
+			if (!(b & 0x80))
+				return x;
+		}
+		throw Exception("Invalid variable-length quantity in MIDI file");
+	}
+};
+
+struct TickEvent {
+	uint64_t tick;
+	/** Microseconds per quarter note if this is a tempo event, otherwise 0. */
+	uint32_t tempo;
+	midi::Message message;
+};
+
+static void readTrack(Reader& r, std::vector<TickEvent>& events) {
+	uint64_t tick = 0;
+	uint8_t runningStatus = 0;
+	while (r.pos < r.size) {
+		tick += r.vlq();
+		uint8_t status = r.u8();
+
+		// Meta event
+		if (status == 0xff) {
+			// Meta and system exclusive events cancel running status
+			runningStatus = 0;
+			uint8_t type = r.u8();
+			uint32_t len = r.vlq();
+			r.require(len);
+			// Set tempo
+			if (type == 0x51 && len == 3) {
+				const uint8_t* d = &r.data[r.pos];
+				events.push_back({tick, (uint32_t) ((d[0] << 16) | (d[1] << 8) | d[2]), midi::Message()});
+			}
+			r.pos += len;
+			// End of track
+			if (type == 0x2f)
+				return;
+			continue;
+		}
+
+		// System exclusive event
+		if (status == 0xf0 || status == 0xf7) {
+			runningStatus = 0;
+			uint32_t len = r.vlq();
+			r.require(len);
+			TickEvent e = {tick, 0, midi::Message()};
+			e.message.bytes.clear();
+			if (status == 0xf0)
+				e.message.bytes.push_back(0xf0);
+			e.message.bytes.insert(e.message.bytes.end(), &r.data[r.pos], &r.data[r.pos + len]);
+			r.pos += len;
+			events.push_back(e);
+			continue;
+		}
+
+		// Channel event, possibly with running status
+		uint8_t data1;
+		if (status & 0x80) {
+			runningStatus = status;
+			data1 = r.u8();
+		}
+		else {
+			if (!runningStatus)
+				throw Exception("MIDI file uses running status without a previous status byte");
+			data1 = status;
+			status = runningStatus;
+		}
+
+		TickEvent e = {tick, 0, midi::Message()};
+		uint8_t command = status >> 4;
+		if (command == 0xc || command == 0xd) {
+			e.message.setSize(2);
+			e.message.bytes[0] = status;
+			e.message.bytes[1] = data1;
+		}
+		else {
+			e.message.bytes[0] = status;
+			e.message.bytes[1] = data1;
+			e.message.bytes[2] = r.u8();
+		}
+		events.push_back(e);
+	}
+}
+
+/** Parses a format 0 or 1 Standard MIDI File and returns its events with tempo-mapped times, in order.
+Throws on error.
+*/
+static std::vector<Event> readFile(const std::string& path) {
+	std::vector<uint8_t> data = system::readFile(path);
+	Reader r(data.data(), data.size());
+
+	if (r.u32() != 0x4d546864) // "MThd"
+		throw Exception("%s is not a Standard MIDI File", path.c_str());
+	uint32_t headerLen = r.u32();
+	size_t headerEnd = r.pos + headerLen;
+	uint32_t format = r.u16();
+	uint32_t numTracks = r.u16();
+	uint32_t division = r.u16();
+	r.pos = headerEnd;
+	if (format > 1)
+		throw Exception("MIDI file format %d is not supported", format);
+
+	std::vector<TickEvent> tickEvents;
+	for (uint32_t i = 0; i < numTracks && r.pos < r.size; i++) {
+		uint32_t chunkType = r.u32();
+		uint32_t chunkLen = r.u32();
+		r.require(chunkLen);
+		if (chunkType == 0x4d54726b) { // "MTrk"
+			Reader trackReader(&r.data[r.pos], chunkLen);
+			readTrack(trackReader, tickEvents);
+		}
+		r.pos += chunkLen;
+	}
+	// Merge tracks, keeping file order for events on the same tick
+	std::stable_sort(tickEvents.begin(), tickEvents.end(), [](const TickEvent& a, const TickEvent& b) {
+		return a.tick < b.tick;
+	});
+
+	// Convert ticks to seconds
+	std::vector<Event> events;
+	double time = 0.0;
+	uint64_t tick = 0;
+	double secondsPerTick;
+	bool smpte = division & 0x8000;
+	if (smpte) {
+		double fps = -(int8_t) (division >> 8);
+		// 29 means 29.97 fps drop-frame
+		if (fps == 29)
+			fps = 30000.0 / 1001;
+		int ticksPerFrame = division & 0xff;
+		secondsPerTick = 1.0 / (fps * ticksPerFrame);
+	}
+	else {
+		// Default tempo is 120 BPM
+		secondsPerTick = 0.5 / division;
+	}
+
+	for (const TickEvent& e : tickEvents) {
+		time += (e.tick - tick) * secondsPerTick;
+		tick = e.tick;
+		if (e.tempo > 0) {
+			if (!smpte)
+				secondsPerTick = e.tempo * 1e-6 / division;
+			continue;
+		}
+		events.push_back({time, e.message});
+	}
+	return events;
+}
+
+
+////////////////////
+// Standard MIDI File writing
+////////////////////
+
+static void writeU16(std::vector<uint8_t>& data, uint32_t x) {
+	data.push_back(x >> 8);
+	data.push_back(x);
+}
+
+static void writeU32(std::vector<uint8_t>& data, uint32_t x) {
+	writeU16(data, x >> 16);
+	writeU16(data, x);
+}
+
+static void writeVlq(std::vector<uint8_t>& data, uint32_t x) {
+	uint8_t bytes[5];
+	int n = 0;
+	do {
+		bytes[n++] = x & 0x7f;
+		x >>= 7;
+	} while (x);
+	while (n > 1)
+		data.push_back(bytes[--n] | 0x80);
+	data.push_back(bytes[0]);
+}
+
+struct FrameEvent {
+	int64_t frame;
+	midi::Message message;
+};
+
+/** Writes a format 0 Standard MIDI File with one tick per Engine frame, so recorded timestamps are sample-accurate.
+*/
+static void writeFile(const std::string& path, const std::vector<FrameEvent>& events, int64_t startFrame, int sampleRate) {
+	// Choose a tempo and resolution whose tick is exactly one frame.
+	// The division must fit in 15 bits, and the tempo is an integer number of microseconds.
+	uint32_t division = 0;
+	uint32_t tempo = 0;
+	for (int k : {1, 2, 4, 5, 8, 10, 16, 20, 25, 32, 40, 50, 64}) {
+		if (sampleRate % k == 0 && sampleRate / k < 0x8000) {
+			division = sampleRate / k;
+			tempo = 1000000 / k;
+			break;
+		}
+	}
+	double ticksPerFrame = 1.0;
+	if (division == 0) {
+		// Fall back to 120 BPM at 960 PPQ
+		division = 960;
+		tempo = 500000;
+		ticksPerFrame = 1920.0 / sampleRate;
+	}
+
+	std::vector<uint8_t> track;
+	// Set tempo
+	writeVlq(track, 0);
+	track.insert(track.end(), {0xff, 0x51, 0x03, (uint8_t) (tempo >> 16), (uint8_t) (tempo >> 8), (uint8_t) tempo});
+
+	uint64_t tick = 0;
+	for (const FrameEvent& e : events) {
+		if (e.message.bytes.empty())
+			continue;
+		uint64_t eventTick = std::max<int64_t>(std::llround((e.frame - startFrame) * ticksPerFrame), 0);
+		eventTick = std::max(eventTick, tick);
+		writeVlq(track, eventTick - tick);
+		tick = eventTick;
+		const std::vector<uint8_t>& bytes = e.message.bytes;
+		if (bytes[0] == 0xf0) {
+			track.push_back(0xf0);
+			writeVlq(track, bytes.size() - 1);
+			track.insert(track.end(), bytes.begin() + 1, bytes.end());
+		}
+		else {
+			track.insert(track.end(), bytes.begin(), bytes.end());
+		}
+	}
+	// End of track
+	writeVlq(track, 0);
+	track.insert(track.end(), {0xff, 0x2f, 0x00});
+
+	std::vector<uint8_t> data;
+	writeU32(data, 0x4d546864); // "MThd"
+	writeU32(data, 6);
+	writeU16(data, 0);
+	writeU16(data, 1);
+	writeU16(data, division);
+	writeU32(data, 0x4d54726b); // "MTrk"
+	writeU32(data, track.size());
+	data.insert(data.end(), track.begin(), track.end());
+	system::writeFile(path, data);
+}
+
+
+////////////////////
+// Devices
+////////////////////
+
+struct InputDevice : midi::InputDevice {
+	std::string path;
+	std::vector<Event> events;
+	Context* context;
+	std::thread thread;
+	std::atomic<bool> running{true};
+	/** Guards `subscribed` between the Driver and the playback thread */
+	std::mutex mutex;
+
+	InputDevice(const std::string& path) : path(path) {
+		events = readFile(path);
+		context = contextGet();
+	}
+
+	/** Starts playback from the beginning of the file.
+	Call with `mutex` locked, after the first Input is subscribed, so its first events aren't dispatched to nobody.
+	*/
+	void start() {
+		if (!thread.joinable())
+			thread = std::thread(&InputDevice::run, this);
+	}
+
+	~InputDevice() {
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	std::string getName() override {
+		return system::getFilename(path);
+	}
+
+	/** Pushes each event to subscribed Inputs shortly before it is due, stamped with its exact Engine frame. */
+	void run() {
+		system::setThreadName("MIDI file input");
+		contextSet(context);
+
+		float sampleRate = APP->engine->getSampleRate();
+		int64_t lookaheadFrames = std::ceil(LOOKAHEAD * sampleRate);
+		int64_t startFrame = APP->engine->getFrame() + lookaheadFrames;
+		size_t i = 0;
+		while (running && i < events.size()) {
+			int64_t maxFrame = APP->engine->getFrame() + lookaheadFrames;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (; i < events.size(); i++) {
+					midi::Message message = events[i].message;
+					message.setFrame(startFrame + (int64_t) std::round(events[i].time * sampleRate));
+					if (message.getFrame() > maxFrame)
+						break;
+					onMessage(message);
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+};
+
+
+struct OutputDevice : midi::OutputDevice {
+	int id;
+	std::vector<FrameEvent> events;
+	std::mutex mutex;
+	int64_t startFrame;
+	float sampleRate;
+
+	OutputDevice(int id) : id(id) {
+		startFrame = APP->engine->getFrame();
+		sampleRate = APP->engine->getSampleRate();
+	}
+
+	~OutputDevice() {
+		if (events.empty())
+			return;
+		std::string dir = getDir();
+		std::string path = system::join(dir, getName() + ".mid");
+		try {
+			system::createDirectories(dir);
+			writeFile(path, events, startFrame, sampleRate);
+			INFO("Recorded %d MIDI messages to %s", (int) events.size(), path.c_str());
+		}
+		catch (Exception& e) {
+			WARN("Could not write MIDI file %s: %s", path.c_str(), e.what());
+		}
+	}
+
+	std::string getName() override {
+		return string::f("Record %d", id + 1);
+	}
+
+	void sendMessage(const midi::Message& message) override {
+		FrameEvent e;
+		e.frame = (message.getFrame() >= 0) ? message.getFrame() : APP->engine->getFrame();
+		e.message = message;
+		std::lock_guard<std::mutex> lock(mutex);
+		events.push_back(e);
+	}
+};
+
+
+////////////////////
+// Driver
+////////////////////
+
+struct Driver : midi::Driver {
+	/** Paths of input devices, refreshed by getInputDeviceIds() */
+	std::vector<std::string> paths;
+	std::map<int, InputDevice*> inputDevices;
+	std::map<int, OutputDevice*> outputDevices;
+
+	~Driver() {
+		assert(inputDevices.empty());
+		assert(outputDevices.empty());
+	}
+
+	std::string getName() override {
+		return "MIDI file";
+	}
+
+	std::vector<int> getInputDeviceIds() override {
+		paths.clear();
+		for (const std::string& path : system::getEntries(getDir())) {
+			std::string ext = string::lowercase(system::getExtension(path));
+			if (ext == ".mid" || ext == ".midi")
+				paths.push_back(path);
+		}
+		std::sort(paths.begin(), paths.end());
+
+		std::vector<int> deviceIds;
+		for (size_t i = 0; i < paths.size(); i++)
+			deviceIds.push_back(i);
+		return deviceIds;
+	}
+
+	std::string getInputDeviceName(int deviceId) override {
+		if (!(0 <= deviceId && deviceId < (int) paths.size()))
+			return "";
+		return system::getFilename(paths[deviceId]);
+	}
+
+	midi::InputDevice* subscribeInput(int deviceId, midi::Input* input) override {
+		if (paths.empty())
+			getInputDeviceIds();
+		if (!(0 <= deviceId && deviceId < (int) paths.size()))
+			return NULL;
+		InputDevice* device = get(inputDevices, deviceId, NULL);
+		if (!device) {
+			inputDevices[deviceId] = device = new InputDevice(paths[deviceId]);
+		}
+		std::lock_guard<std::mutex> lock(device->mutex);
+		device->subscribe(input);
+		device->start();
+		return device;
+	}
+
+	void unsubscribeInput(int deviceId, midi::Input* input) override {
+		auto it = inputDevices.find(deviceId);
+		if (it == inputDevices.end())
+			return;
+		InputDevice* device = it->second;
+		bool empty;
+		{
+			std::lock_guard<std::mutex> lock(device->mutex);
+			device->unsubscribe(input);
+			empty = device->subscribed.empty();
+		}
+
+		// Destroy device if nothing is subscribed anymore
+		if (empty) {
+			inputDevices.erase(it);
+			delete device;
+		}
+	}
+
+	std::vector<int> getOutputDeviceIds() override {
+		std::vector<int> deviceIds;
+		for (size_t i = 0; i < NUM_RECORDERS; i++)
+			deviceIds.push_back(i);
+		return deviceIds;
+	}
+
+	int getDefaultOutputDeviceId() override {
+		return 0;
+	}
+
+	std::string getOutputDeviceName(int deviceId) override {
+		if (!(0 <= deviceId && (size_t) deviceId < NUM_RECORDERS))
+			return "";
+		return string::f("Record %d", deviceId + 1);
+	}
+
+	midi::OutputDevice* subscribeOutput(int deviceId, midi::Output* output) override {
+		if (!(0 <= deviceId && (size_t) deviceId < NUM_RECORDERS))
+			return NULL;
+		OutputDevice* device = get(outputDevices, deviceId, NULL);
+		if (!device) {
+			outputDevices[deviceId] = device = new OutputDevice(deviceId);
+		}
+		device->subscribe(output);
+		return device;
+	}
+
+	void unsubscribeOutput(int deviceId, midi::Output* output) override {
+		auto it = outputDevices.find(deviceId);
+		if (it == outputDevices.end())
+			return;
+		OutputDevice* device = it->second;
+		device->unsubscribe(output);
+
+		// Write file and destroy device if nothing is subscribed anymore
+		if (device->subscribed.empty()) {
+			outputDevices.erase(it);
+			delete device;
+		}
+	}
+};
+
+
+void init() {
+	Driver* driver = new Driver;
+	midi::addDriver(DRIVER_ID, driver);
+}
+
+
+} // namespace midifile
+} // namespace rack
@@ -1,6 +1,10 @@
+#include <atomic>
+
 #include <midiloopback.hpp>
 #include <context.hpp>
 #include <string.hpp>
+#include <system.hpp>
+#include <engine/Engine.hpp>
 
 
 namespace rack {
@@ -9,17 +13,127 @@ namespace midiloopback {
 
 static const int DRIVER_ID = -12;
 static const size_t NUM_DEVICES = 16;
+/** Must be a power of 2. */
+static const size_t RING_SIZE = 256;
+
 
+/** A loopback device which writes each sent message once into a shared ring and fans it out to all subscribed Inputs from there.
 
+Senders may be any number of engine threads, so slots are claimed with a bounded multi-producer queue (one sequence number per slot).
+Only one thread at a time delivers published slots to the subscribers, passing each message by reference without copying it per Input.
+*/
 struct Device : midi::InputDevice, midi::OutputDevice {
+	struct Slot {
+		/** Equals the slot's write position when free, write position + 1 when published. */
+		std::atomic<uint64_t> seq{0};
+		midi::Message message;
+	};
+
 	int id = -1;
+	Slot slots[RING_SIZE];
+	std::atomic<uint64_t> writePos{0};
+	/** Only advanced by the thread holding `delivering`. */
+	std::atomic<uint64_t> readPos{0};
+	std::atomic_flag delivering = ATOMIC_FLAG_INIT;
+	/** Number of messages rejected because the ring was full. */
+	std::atomic<uint64_t> droppedCount{0};
+
+	Device() {
+		for (size_t i = 0; i < RING_SIZE; i++) {
+			slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
 
 	std::string getName() override {
 		return string::f("Loopback %d", id + 1);
 	}
 
 	void sendMessage(const midi::Message& message) override {
-		onMessage(message);
+		if (!push(message))
+			return;
+		deliver();
+	}
+
+	/** Writes the message into the next free slot.
+	Returns false and drops the message if the ring is full.
+	*/
+	bool push(const midi::Message& message) {
+		uint64_t pos = writePos.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true) {
+			slot = &slots[pos & (RING_SIZE - 1)];
+			uint64_t seq = slot->seq.load(std::memory_order_acquire);
+			int64_t diff = (int64_t) seq - (int64_t) pos;
+			if (diff == 0) {
+				if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				// Reader hasn't caught up
+				droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else {
+				pos = writePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		// Copy-assignment reuses the slot's byte storage for messages no larger than previous ones.
+		slot->message = message;
+		// Stamp the frame once here instead of once per subscriber in InputDevice::onMessage().
+		if (slot->message.getFrame() < 0) {
+			double deltaTime = system::getTime() - APP->engine->getBlockTime();
+			int64_t deltaFrames = std::floor(deltaTime * APP->engine->getSampleRate());
+			// Delay message by current Engine block size
+			deltaFrames += APP->engine->getBlockFrames();
+			slot->message.setFrame(APP->engine->getBlockFrame() + deltaFrames);
+		}
+		// Sequentially consistent with `delivering` so deliver() never misses a publish.
+		slot->seq.store(pos + 1, std::memory_order_seq_cst);
+		return true;
+	}
+
+	uint64_t getDroppedCount() override {
+		return droppedCount.load(std::memory_order_relaxed);
+	}
+
+	/** Passes all published slots to subscribed Inputs.
+	If another thread is already delivering, it picks up our message before releasing the flag.
+	*/
+	void deliver() {
+		while (true) {
+			if (delivering.test_and_set(std::memory_order_seq_cst))
+				return;
+
+			uint64_t pos = readPos.load(std::memory_order_relaxed);
+			while (true) {
+				Slot& slot = slots[pos & (RING_SIZE - 1)];
+				if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+					break;
+				dispatch(slot.message);
+				slot.seq.store(pos + RING_SIZE, std::memory_order_release);
+				pos++;
+			}
+			readPos.store(pos, std::memory_order_relaxed);
+
+			delivering.clear(std::memory_order_seq_cst);
+			// A sender may have published after our last check but failed to take the flag.
+			Slot& slot = slots[pos & (RING_SIZE - 1)];
+			if (slot.seq.load(std::memory_order_seq_cst) != pos + 1)
+				return;
+		}
+	}
+
+	void dispatch(const midi::Message& message) {
+		bool system = (message.getStatus() == 0xf);
+		uint8_t channel = message.getChannel();
+		for (midi::Input* input : InputDevice::subscribed) {
+			// Filter channel if message is not a system MIDI message
+			if (!system && input->channel >= 0 && channel != input->channel)
+				continue;
+			contextSet(input->context);
+			input->onMessage(message);
+		}
 	}
 };
 
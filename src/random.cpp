@@ -1,35 +1,144 @@
+#include <atomic>
+#include <mutex>
+
 #include <random.hpp>
 #include <math.hpp>
 #include <system.hpp>
+#include <simd/functions.hpp>
 
 
 namespace rack {
 namespace random {
 
 
-static Xoroshiro128Plus rng;
+static std::atomic<uint64_t> masterSeed{0};
+/** The seed generation in the high 32 bits, incremented by seed() so each thread reseeds its generators on next use, and the stream index of the next thread to seed its generators in the low 32 bits.
+Packed so that seed() resets the stream index in the same store that increments the generation, and each thread takes a stream of the generation it seeds with.
+*/
+static std::atomic<uint64_t> seedState{uint64_t(1) << 32};
+/** Serializes seed() calls */
+static std::mutex seedMutex;
+static std::atomic<bool> seeded{false};
+
+
+/** Generators of a thread.
+Zero-initialized, so the first use of each thread seeds them.
+*/
+struct ThreadState {
+	Xoroshiro128Plus rng;
+	Xoshiro128PlusVector vectorRng;
+	/** The seed generation when the generators were last seeded, or 0 if never */
+	uint32_t generation;
+};
+
+static thread_local ThreadState threadState;
+
+
+/** SplitMix64, recommended for seeding xoroshiro generators from a single 64-bit value */
+static uint64_t splitMix64(uint64_t& x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+
+static ThreadState& getThreadState() {
+	ThreadState& ts = threadState;
+	uint32_t generation = seedState.load(std::memory_order_acquire) >> 32;
+	if (ts.generation != generation) {
+		// Take the next stream of the current generation
+		uint64_t state = seedState.fetch_add(1, std::memory_order_acq_rel);
+		generation = state >> 32;
+		uint64_t stream = uint32_t(state);
+		// Derive an independent sequence from the master seed and this thread's stream
+		uint64_t x = stream;
+		x = splitMix64(x) ^ masterSeed.load(std::memory_order_relaxed);
+		uint64_t s0 = splitMix64(x);
+		uint64_t s1 = splitMix64(x);
+		ts.rng.seed(s0, s1);
+
+		uint32_t vs[16];
+		for (int i = 0; i < 16; i += 2) {
+			uint64_t r = splitMix64(x);
+			vs[i] = r;
+			vs[i + 1] = r >> 32;
+		}
+		ts.vectorRng.seed(vs);
+		ts.generation = generation;
+	}
+	return ts;
+}
 
 
 void init() {
 	// Don't reset state if already seeded
-	if (rng.isSeeded())
+	if (seeded)
 		return;
 
 	// Get epoch time for seed
 	double time = system::getUnixTime();
 	uint64_t sec = time;
 	uint64_t nsec = std::fmod(time, 1.0) * 1e9;
-	rng.seed(sec, nsec);
+	seed(sec * 1000000000 + nsec);
+}
 
-	// Shift state a few times due to low seed entropy
-	for (int i = 0; i < 4; i++) {
-		rng();
-	}
+
+void seed(uint64_t seed) {
+	std::lock_guard<std::mutex> lock(seedMutex);
+	masterSeed.store(seed, std::memory_order_relaxed);
+	// Generation 0 means never seeded
+	uint32_t generation = (seedState.load(std::memory_order_relaxed) >> 32) + 1;
+	if (generation == 0)
+		generation = 1;
+	// Start the new generation at stream 0
+	seedState.store(uint64_t(generation) << 32, std::memory_order_release);
+	seeded = true;
 }
 
 
 Xoroshiro128Plus& local() {
-	return rng;
+	return getThreadState().rng;
+}
+
+
+Xoshiro128PlusVector& localVector() {
+	return getThreadState().vectorRng;
+}
+
+
+void uniformBuffer(float* out, size_t len) {
+	Xoshiro128PlusVector& rng = localVector();
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		rng.uniform().store(&out[i]);
+	}
+	if (i < len) {
+		simd::float_4 r = rng.uniform();
+		for (size_t j = 0; i + j < len; j++) {
+			out[i + j] = r[j];
+		}
+	}
+}
+
+
+void normalBuffer(float* out, size_t len) {
+	Xoshiro128PlusVector& rng = localVector();
+	for (size_t i = 0; i < len; i += 8) {
+		// Box-Muller transform, using both the sine and cosine outputs
+		simd::float_4 radius = simd::sqrt(-2.f * simd::log(1.f - rng.uniform()));
+		simd::float_4 theta = float(2 * M_PI) * rng.uniform();
+		simd::float_4 y[2] = {radius * simd::cos(theta), radius * simd::sin(theta)};
+		if (i + 8 <= len) {
+			y[0].store(&out[i]);
+			y[1].store(&out[i + 4]);
+		}
+		else {
+			for (size_t j = 0; i + j < len; j++) {
+				out[i + j] = y[j / 4][j % 4];
+			}
+		}
+	}
 }
 
 
@@ -4,6 +4,9 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <bitset>
+#include <tuple>
 
 #pragma GCC diagnostic push
 #ifndef __clang__
@@ -86,6 +89,11 @@ struct RtMidiInputDevice : midi::InputDevice {
 };
 
 
+/** Messages due within this duration of the earliest queued message are sent together. */
+static const double RtMidiOutputDevice_batchDuration = 0.001;
+static const size_t RtMidiOutputDevice_maxSize = 8192;
+
+
 struct RtMidiOutputDevice : midi::OutputDevice {
 	RtMidiOut* rtMidiOut;
 	std::string name;
@@ -93,18 +101,28 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 	struct MessageSchedule {
 		midi::Message message;
 		double timestamp;
+		/** Preserves ordering of messages with equal timestamps, since priority_queue is unstable. */
+		uint64_t seq;
 
 		bool operator<(const MessageSchedule& other) const {
-			return timestamp > other.timestamp;
+			return std::make_tuple(timestamp, seq) > std::make_tuple(other.timestamp, other.seq);
 		}
 	};
 	std::priority_queue<MessageSchedule, std::vector<MessageSchedule>> messageQueue;
+	uint64_t nextSeq = 0;
+	/** Owned by the worker thread */
+	std::vector<midi::Message> batch;
 
 	std::thread thread;
 	std::mutex mutex;
 	std::condition_variable cv;
 	bool stopped = false;
 
+	/** Number of messages rejected because the queue was full. */
+	std::atomic<uint64_t> droppedCount{0};
+	/** Number of CC, pressure, and pitch wheel messages superseded by a later one in the same batch. */
+	std::atomic<uint64_t> coalescedCount{0};
+
 	RtMidiOutputDevice(int driverId, int deviceId) {
 		try {
 			rtMidiOut = new RtMidiOut((RtMidi::Api) driverId, "VCV Rack");
@@ -159,10 +177,29 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 		ms.timestamp = APP->engine->getBlockTime() + deltaTime;
 
 		std::lock_guard<decltype(mutex)> lock(mutex);
+		// Reject MIDI message if queue is full
+		if (messageQueue.size() >= RtMidiOutputDevice_maxSize) {
+			droppedCount++;
+			return;
+		}
+		ms.seq = nextSeq++;
 		messageQueue.push(ms);
 		cv.notify_one();
 	}
 
+	size_t getQueueSize() override {
+		std::lock_guard<decltype(mutex)> lock(mutex);
+		return messageQueue.size();
+	}
+
+	uint64_t getDroppedCount() override {
+		return droppedCount;
+	}
+
+	uint64_t getCoalescedCount() override {
+		return coalescedCount;
+	}
+
 	// Consumer thread methods
 
 	void startThread() {
@@ -180,8 +217,8 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 			}
 			else {
 				// Get earliest message
-				const MessageSchedule& ms = messageQueue.top();
-				double duration = ms.timestamp - system::getTime();
+				double timestamp = messageQueue.top().timestamp;
+				double duration = timestamp - system::getTime();
 
 				// If we need to wait, release the lock and wait for the timeout, or if the CV is notified.
 				// This correctly handles MIDI messages with no timestamp, because duration will be NAN.
@@ -190,9 +227,89 @@ struct RtMidiOutputDevice : midi::OutputDevice {
 						continue;
 				}
 
-				// Send and remove from queue
-				sendMessageNow(ms.message);
-				messageQueue.pop();
+				// Pop all messages due within the batch window
+				double batchTimestamp = timestamp + RtMidiOutputDevice_batchDuration;
+				batch.clear();
+				while (!messageQueue.empty()) {
+					const MessageSchedule& ms = messageQueue.top();
+					if (ms.timestamp > batchTimestamp)
+						break;
+					batch.push_back(ms.message);
+					messageQueue.pop();
+				}
+
+				// Send batch without blocking the engine's sendMessage()
+				lock.unlock();
+				coalesceBatch();
+				for (const midi::Message& message : batch) {
+					if (message.getSize() > 0)
+						sendMessageNow(message);
+				}
+				lock.lock();
+			}
+		}
+	}
+
+	/** Returns whether a CC's value depends on the order of other messages, so it must never be coalesced.
+	*/
+	static bool isOrderedController(uint8_t cc) {
+		// Bank select MSB/LSB, data entry MSB/LSB
+		if (cc == 0 || cc == 6 || cc == 32 || cc == 38)
+			return true;
+		// Sustain, portamento, sostenuto, soft pedal, legato, hold 2
+		if (64 <= cc && cc <= 69)
+			return true;
+		// Data increment/decrement, NRPN and RPN parameter numbers
+		if (96 <= cc && cc <= 101)
+			return true;
+		// Channel mode messages
+		if (120 <= cc)
+			return true;
+		return false;
+	}
+
+	/** Returns a key identifying the controller a message sets, or -1 if the message must not be coalesced.
+	*/
+	static int getCoalesceKey(const midi::Message& message) {
+		uint8_t status = message.getStatus();
+		uint8_t channel = message.getChannel();
+		switch (status) {
+			// Polyphonic key pressure, CC: keyed by channel and note/controller
+			case 0xa:
+			case 0xb: {
+				if (message.getSize() != 3)
+					return -1;
+				if (status == 0xb && isOrderedController(message.getNote()))
+					return -1;
+				return (((status - 0xa) * 16 + channel) << 7) | message.getNote();
+			}
+			// Channel pressure, pitch wheel: keyed by channel
+			case 0xd:
+			case 0xe: {
+				return 2 * 16 * 128 + (status - 0xd) * 16 + channel;
+			}
+			default: return -1;
+		}
+	}
+
+	/** Empties all but the last message of each run of messages setting the same controller.
+	A run ends at any message that can't be coalesced, such as a note, so controllers keep their value relative to notes and other ordered messages.
+	*/
+	void coalesceBatch() {
+		std::bitset<2 * 16 * 128 + 2 * 16> seen;
+		for (auto it = batch.rbegin(); it != batch.rend(); it++) {
+			int key = getCoalesceKey(*it);
+			if (key < 0) {
+				// Messages before this one can't be superseded by messages after it.
+				seen.reset();
+				continue;
+			}
+			if (seen[key]) {
+				it->setSize(0);
+				coalescedCount++;
+			}
+			else {
+				seen[key] = true;
 			}
 		}
 	}